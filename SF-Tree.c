@@ -3,8 +3,60 @@
  
   SF-Tree.c 
   
-  To compile: gcc -Wall SF-Tree.c -o prog -lm
-  To run: ./prog inputFile utilityTable outputFile minShare
+  To compile: gcc -Wall -O3 SF-Tree.c -o prog -lm -lpthread
+  To run: ./prog inputFile utilityTable outputFile minShare [options]
+
+  Options:
+    -m budgetMB   memory budget for the trees; conditional pattern bases
+                  that would exceed it are spilled to $TMPDIR and mined
+                  from disk afterwards (default: unlimited)
+    -p nodes      conditional bases with at most this many path nodes
+                  are mined in place over the parent tree instead of
+                  being copied into a new tree (default: 16, 0 = off)
+    -M mode       all: every group (default); closed: no supergroup with
+                  the same climp; maximal: no supergroup reaching the
+                  climp bound. Checked before the dgimp filter.
+    -s            scan the database a third time and recompute dgimp of
+                  every group, reporting groups where the value computed
+                  in the tree differs (default: off)
+    -o format     output file format: text (default), ndjson or binary;
+                  see writeItemset
+    -q            do not echo the groups to stdout
+    -t workers    build the tree with a pipeline: a reader thread parses
+                  the transactions in batches, this many threads filter
+                  and sort them and the main thread inserts them in
+                  input order (default: 0, all in the main thread)
+    -T            also report CPU time and peak RSS per phase
+    -g golden     compare the groups found with the groups of an earlier
+                  text output file
+    -B baseline   save the phase times and peak RSS of this run
+    -b baseline   compare them with a saved baseline (implies -T)
+    -r tolerance  percent a phase may exceed the baseline (default: 25)
+                  The exit status is 1 when -g or -b finds a difference.
+    -S socket     keep the tree and answer queries on this Unix socket
+                  (see serveQueries); minSig is the lowest one served
+    -P parts      mine in this many worker processes, each one building
+                  and mining the tree of its share of the header items
+                  (see minePartitions; default: 1)
+    -O order      global header order: climp (descending, default),
+                  freq (transactions with the item), degree (items it
+                  occurs with) or asc (ascending climp). The node counts
+                  of the global and projected trees are reported.
+    -i            projected headers keep the parent order instead of
+                  being sorted by conditional climp (SORT_TREE)
+    -c            compact the global tree, and projected trees of at
+                  least COMPACT_NODES nodes, into one block in DFS order
+    -E engine     hybrid (default): FPgrowth mines each conditional base
+                  in place, as bitmaps or as a projected tree from its
+                  size, density and the prefix sharing of the parent
+                  tree (HYBRID_*); tree: always projected trees;
+                  vertical: intersect per-item bitmaps of all the
+                  transactions (see vertGrowth), for small dense
+                  headers. Same groups and friends; -m, -p, -i and -c
+                  only apply to the trees.
+    -e            the database is an edge list, "user friend weight"
+                  triples in any order; it is grouped by user with an
+                  external sort in runs bounded by -m (see groupEdges)
 
   Example Friend Database:
   
@@ -42,8 +94,8 @@
   8 0.20
   1 0.50
 
-  Note: To get the correct results set SORT_TREE to 1, everything else 0, to see the results set PRF_FP to 1
-  When SORT_TREE is set to 0, not getting the right results.
+  Note: SORT_TREE (or -i to turn it off) picks the order of the projected headers;
+  both orders give the same groups. To see the results set PRT_FP to 1.
   
   ****IMPORTANT:
   If not getting consistent results, might have to increase MAXITEMSETS if run out of
@@ -58,8 +110,18 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
 #include <math.h>
-#include <sys/time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <errno.h>
 #include "SF-Tree.h"
 
 #define DEBUG     0
@@ -69,52 +131,267 @@
 #define CNT_MEM   0
 #define PRT_MEM   0
 #define PRT_FALSE_POS  0	//print number of false positives
-#define SORT_TREE 1 /* default: 1 */ //don't set this to 0
+#define SORT_TREE 1 /* default: 1 */ //projected headers by conditional climp; 0 keeps the parent order
 #define SING_PATH 0 /* default: 1 */ //set this to 1
+#define PSEUDO_NODES 16 /* default: 16 */ //pseudo-projection threshold in path nodes
+#define SORT_SMALL 16 /* default: 16 */ //lists up to this size use insertion sort
+#define BENCH_SORT 0 /* default: 0 */ //set to 1 to only run the sort microbenchmark
+#define DEDUP_TRANS 1 /* default: 1 */ //insert identical filtered transactions once
+#define COMPACT_NODES 4096 /* default: 4096 */ //with -c, projected trees this large are compacted
+#define PAIR_COUNTS 1 /* default: 1 */ //count item pairs while a tree is built
+#define PAIR_MAX_HDR 512 /* default: 512 */ //largest header that gets a pair matrix
+#define HYBRID_MAX_HDR 64 /* default: 64 */ //with -E hybrid, largest projected header mined as bitmaps
+#define HYBRID_DENSITY 30 /* default: 30 */ //and the least percent of its path cells filled
+#define HYBRID_SPREAD 50 /* default: 50 */ //when the parent tree has at least this percent of its cells as nodes
 
 int setTransNum;
-Itemset FP[MAXITEMSETS + 1]; //keep a list of frequent patterns found
-int sizeFP;
+/*
+  Mining state is per thread (__thread) so the server threads can each
+  mine the resident tree at once; the options are shared.
+*/
+__thread Itemset *FP; //index of the frequent patterns found (at most MAXITEMSETS)
+__thread int sizeFP;
+__thread int capFP;
+__thread int *fpItems;	/* pattern arena: the items of FP[i] are at FP[i].off */
+__thread long fpLen;
+__thread long fpCap;
+__thread FPList *fpByItem;	/* closed/maximal: item -> the patterns holding it */
+__thread FPList *fpByClimp;	/* closed/maximal: climp bucket -> its patterns */
+__thread int climpBuckets;
+
+__thread int initial_number;
+int mineMode;
+int sortTree;		/* SORT_TREE, or FALSE with -i */
+int hdrOrder;		/* order of the global header, ORDER_* */
+int compactTrees;	/* -c: relocate trees into one block in DFS order */
+int engine;		/* -E: ENGINE_* mining the global database */
+__thread long nodesMade;	/* tree nodes created, for the node count report */
+__thread long basesBy[4];	/* conditional bases mined as BASE_* */
+int echoCandidates = TRUE;	/* print each candidate as it is found */
+
+#define BASE_TREE	0
+#define BASE_PSEUDO	1
+#define BASE_BITMAP	2
+#define BASE_SPILL	3
+
+#define FP_ITEMS(I)	(fpItems + (I)->off)
+
+#if ITEM_MASK
+#define ITEM_BIT(i)	((itemmask_t)1 << ((i) - 1))
+#endif
+
+/*
+  Pattern store. openFP starts pattern sizeFP at the end of the arena,
+  add_item appends its items in any order and closeFP sorts them and
+  keeps it; FP and the arena grow as needed, so the store takes memory
+  for the items found instead of MAXITEMSETS universe-wide rows.
+  Closed and maximal mining also index each pattern under its items and
+  its climp, so a superset is looked up in the shortest of those lists
+  instead of the whole store.
+*/
 
-int initial_number;
+#define CLIMP_BUCKET(c)	((int)((((uint64_t)(c) * 0x9E3779B97F4A7C15ULL) >> 32) & (uint64_t)(climpBuckets - 1)))
+
+void addFPList(FPList *L, int i){
+
+	if(L->size == L->cap){
+		L->cap = (L->cap == 0 ? 4 : 2 * L->cap);
+		L->fp = (int *)realloc(L->fp, L->cap * sizeof(int));
+		if(L->fp == NULL){
+			fprintf(stderr, "ERROR[addFPList]\n");
+			exit(0);
+		}
+	}
+	L->fp[L->size ++] = i;
+}
+
+FPList *newFPLists(int n){
+
+	FPList *L = (FPList *)calloc(n, sizeof(FPList));
+	if(L == NULL){
+		fprintf(stderr, "ERROR[newFPLists]\n");
+		exit(0);
+	}
+	return L;
+}
+
+void freeFPLists(FPList *L, int n){
 
-void init_itemset(Itemset *I){
-	
 	int i;
-	for(i = 1; i <= MAXITEMS; i ++){
-		I->items[i] = 0;
+	if(L == NULL){
+		return;
+	}
+	for(i = 0; i < n; i ++){
+		free(L[i].fp);
+	}
+	free(L);
+}
+
+/* indexes FP[i], the newest pattern indexed; the climp buckets double with the store */
+void indexFP(int i){
+
+	int j, *a = FP_ITEMS(&FP[i]);
+
+	if(fpByItem == NULL){
+		fpByItem = newFPLists(MAXITEMS + 1);
+		climpBuckets = 256;
+		fpByClimp = newFPLists(climpBuckets);
+	}
+	for(j = 0; j < FP[i].len; j ++){
+		addFPList(&fpByItem[a[j]], i);
+	}
+	if(i + 1 > 2 * climpBuckets){
+		freeFPLists(fpByClimp, climpBuckets);
+		climpBuckets *= 2;
+		fpByClimp = newFPLists(climpBuckets);
+		for(j = 0; j <= i; j ++){
+			addFPList(&fpByClimp[CLIMP_BUCKET(FP[j].climp)], j);
+		}
+	}
+	else{
+		addFPList(&fpByClimp[CLIMP_BUCKET(FP[i].climp)], i);
+	}
+}
+
+/* empties the lists of the stored patterns, while their items are still in the arena */
+void unindexFP(void){
+
+	long p;
+	int i;
+	if(fpByItem == NULL){
+		return;
+	}
+	for(p = 0; p < fpLen; p ++){
+		fpByItem[fpItems[p]].size = 0;
+	}
+	for(i = 0; i < sizeFP; i ++){
+		fpByClimp[CLIMP_BUCKET(FP[i].climp)].size = 0;
+	}
+}
+
+Itemset *openFP(void){
+
+	Itemset *I;
+
+	if(sizeFP == MAXITEMSETS){
+		printf("\nNEED TO INCREASE MAXITEMSETS");
+		exit(-1);
+	}
+	if(sizeFP == capFP){
+		capFP = MIN(2 * capFP, MAXITEMSETS);
+		FP = (Itemset *)realloc(FP, capFP * sizeof(Itemset));
+		if(FP == NULL){
+			fprintf(stderr, "ERROR[openFP]\n");
+			exit(0);
+		}
 	}
+	I = &FP[sizeFP];
+	I->off = fpLen;
+	I->len = 0;
+#if ITEM_MASK
+	I->mask = 0;
+#endif
 	I->climp = 0;
 	I->dgimp = 0;
 	I->info = NULL;
+	return I;
 }
 
-void init_transaction(Transaction *T){
-	
-	int i;
-	for(i = 1; i <= MAXITEMS; i ++){
-		T->itemset[i] = 0;
+/* I is the open pattern */
+void add_item(Itemset *I, int item){
+
+	if(fpLen == fpCap){
+		fpCap *= 2;
+		fpItems = (int *)realloc(fpItems, fpCap * sizeof(int));
+		if(fpItems == NULL){
+			fprintf(stderr, "ERROR[add_item]\n");
+			exit(0);
+		}
+	}
+	fpItems[fpLen ++] = item;
+	I->len ++;
+#if ITEM_MASK
+	I->mask |= ITEM_BIT(item);
+#endif
+}
+
+void closeFP(Itemset *I){
+
+	int i, j, x, *a = FP_ITEMS(I);
+
+	for(i = 1; i < I->len; i ++){
+		x = a[i];
+		for(j = i; j > 0 && a[j-1] > x; j --){
+			a[j] = a[j-1];
+		}
+		a[j] = x;
+	}
+	sizeFP ++;
+	if(mineMode != MINE_ALL){
+		indexFP(sizeFP - 1);
+	}
+}
+
+/* empties the store; the infos must have been released */
+void clearFP(void){
+	unindexFP();
+	sizeFP = 0;
+	fpLen = 0;
+}
+
+void allocFP(void){
+
+	capFP = MIN(256, MAXITEMSETS);
+	fpCap = 1024;
+	FP = (Itemset *)malloc(capFP * sizeof(Itemset));
+	fpItems = (int *)malloc(fpCap * sizeof(int));
+	if(FP == NULL || fpItems == NULL){
+		fprintf(stderr, "ERROR[allocFP]\n");
+		exit(0);
+	}
+	clearFP();
+}
+
+void freeFP(void){
+	free(FP);
+	free(fpItems);
+	freeFPLists(fpByItem, MAXITEMS + 1);
+	freeFPLists(fpByClimp, climpBuckets);
+	FP = NULL;
+	fpItems = NULL;
+	fpByItem = NULL;
+	fpByClimp = NULL;
+}
+
+boolean has_item(Itemset *I, int item){
+
+#if ITEM_MASK
+	return (item >= 1 && item <= MAXITEMS && (I->mask & ITEM_BIT(item))) ? true : false;
+#else
+	int i, *a = FP_ITEMS(I);
+	for(i = 0; i < I->len && a[i] <= item; i ++){
+		if(a[i] == item){
+			return true;
+		}
 	}
+	return false;
+#endif
 }
 
-void print_itemset(Itemset *I, FILE *fpRev){
+void init_transaction(Transaction *T){
 	
 	int i;
-	printf("\n{ ");
-	fprintf(fpRev, "\n{ ");
 	for(i = 1; i <= MAXITEMS; i ++){
-		if(I->items[i] == 1){
-			printf("%d ", i);
-			fprintf(fpRev, "%d ", i);
-		}
+		T->itemset[i] = 0;
 	}
-	printf("}");
-	fprintf(fpRev, "}");	
+#if ITEM_MASK
+	T->mask = 0;
+#endif
 }
 
 /* sort desc key, asc datum1 */
 int compU1( longList *A, int x, int y ){
-  int diff;
+  weight_t diff;
 
   diff = A->key[x] - A->key[y];
   if( diff == 0 )
@@ -122,8 +399,8 @@ int compU1( longList *A, int x, int y ){
   return (diff < 0 ? -1 : 1);
 }
 
-int compU2( longList *A, int x, int key, int datum ){
-  int diff;
+int compU2( longList *A, int x, weight_t key, int datum ){
+  weight_t diff;
 
   diff = A->key[x] - key;
   if( diff == 0 )
@@ -133,7 +410,7 @@ int compU2( longList *A, int x, int key, int datum ){
 
 void heapifyMaxUQ( longList *A, int i ){
   int l, r, largest;
-  int temp;
+  weight_t temp;
 
   l = LEFT(i);
   r = RIGHT(i);
@@ -154,8 +431,8 @@ void heapifyMaxUQ( longList *A, int i ){
   }
 }
 
-int extractMaxUQ( longList *A, int *datum1 ){
-  int max;
+weight_t extractMaxUQ( longList *A, int *datum1 ){
+  weight_t max;
 
   if( A->size < 1 ){
     fprintf( stderr, "ERROR[extractMaxUQ]: Heap underflow\n" );
@@ -171,7 +448,7 @@ int extractMaxUQ( longList *A, int *datum1 ){
   return max;
 }
 
-void insMaxUQ( longList *A, int keyVal, int datum1 ){
+void insMaxUQ( longList *A, weight_t keyVal, int datum1 ){
   int i;
 
   if( A->size >= MAXQITEM ){
@@ -192,7 +469,7 @@ void insMaxUQ( longList *A, int keyVal, int datum1 ){
 
 void heapifyMinUQ( longList *A, int i ){
   int l, r, smallest;
-  int temp;
+  weight_t temp;
 
   l = LEFT(i);
   r = RIGHT(i);
@@ -213,8 +490,8 @@ void heapifyMinUQ( longList *A, int i ){
   }
 }
 
-int extractMinUQ( longList *A, int *datum1 ){
-  int min;
+weight_t extractMinUQ( longList *A, int *datum1 ){
+  weight_t min;
 
   if( A->size < 1 ){
     fprintf( stderr, "ERROR[extractMinUQ]: Heap underflow\n" );
@@ -231,7 +508,7 @@ int extractMinUQ( longList *A, int *datum1 ){
 }
 
 //keyVal is the lgwt and datum1 is the item
-void insMinUQ( longList *A, int keyVal, int datum1 ){
+void insMinUQ( longList *A, weight_t keyVal, int datum1 ){
   int i;
 
   if( A->size >= MAXQITEM ){
@@ -251,7 +528,8 @@ void insMinUQ( longList *A, int keyVal, int datum1 ){
 }
 
 void heapSortAscUQ( longList *A ){
-  int i, temp;
+  int i;
+  weight_t temp;
   int heapSize;
 
   heapSize = A->size;
@@ -269,7 +547,8 @@ void heapSortAscUQ( longList *A ){
 }
 
 void heapSortDescUQ( longList *A ){
-  int i, temp;
+  int i;
+  weight_t temp;
   int heapSize;
 
   heapSize = A->size;
@@ -291,7 +570,7 @@ void showHeapUQ( longList *A ){
 
   printf( "Heap(size=%d):\n\t", A->size );
   for( i=1, maxNode=2; i <= A->size; i++ ){
-    printf( "%d <%d> ", A->key[i], A->datum1[i] );
+    printf( "%lld <%d> ", (long long)A->key[i], A->datum1[i] );
     if( (i+1) % maxNode == 0 ){
       printf( "\n\t" );
       maxNode *= 2;
@@ -305,7 +584,7 @@ void showList( longList *A ){
 
   printf( "longList(size=%d):\n\t", A->size );
   for( i=1; i <= A->size; i++ )
-    printf( "%d <%d> ", A->key[i], A->datum1[i] );
+    printf( "%lld <%d> ", (long long)A->key[i], A->datum1[i] );
   printf( "\n" );
 }
 
@@ -314,7 +593,7 @@ void showList( longList *A ){
 /* sort desc key, asc datum1 */
 
 int compSU1( shortList *A, int x, int y ){
-  int diff;
+  weight_t diff;
 
   diff = A->key[x] - A->key[y];
   if( diff == 0 )
@@ -322,8 +601,8 @@ int compSU1( shortList *A, int x, int y ){
   return (diff < 0 ? -1 : 1);
 }
 
-int compSU2( shortList *A, int x, int key, int datum ){
-  int diff;
+int compSU2( shortList *A, int x, weight_t key, int datum ){
+  weight_t diff;
 
   diff = A->key[x] - key;
   if( diff == 0 )
@@ -333,7 +612,7 @@ int compSU2( shortList *A, int x, int key, int datum ){
 
 void heapifyMaxUList( shortList *A, int i ){
   int l, r, largest;
-  int temp;
+  weight_t temp;
 
   l = LEFT(i);
   r = RIGHT(i);
@@ -354,8 +633,8 @@ void heapifyMaxUList( shortList *A, int i ){
   }
 }
 
-int extractMaxUList( shortList *A, int *datum1 ){
-  int max;
+weight_t extractMaxUList( shortList *A, int *datum1 ){
+  weight_t max;
 
   if( A->size < 1 ){
     fprintf( stderr, "ERROR[extractMaxUList]: Heap underflow\n" );
@@ -371,7 +650,7 @@ int extractMaxUList( shortList *A, int *datum1 ){
   return max;
 }
 
-void insMaxUList( shortList *A, int keyVal, int datum1 ){
+void insMaxUList( shortList *A, weight_t keyVal, int datum1 ){
   int i;
 
   if( A->size >= MAXQITEM ){
@@ -392,7 +671,7 @@ void insMaxUList( shortList *A, int keyVal, int datum1 ){
 
 void heapifyMinUList( shortList *A, int i ){
   int l, r, smallest;
-  int temp;
+  weight_t temp;
 
   l = LEFT(i);
   r = RIGHT(i);
@@ -413,8 +692,8 @@ void heapifyMinUList( shortList *A, int i ){
   }
 }
 
-int extractMinUList( shortList *A, int *datum1 ){
-  int min;
+weight_t extractMinUList( shortList *A, int *datum1 ){
+  weight_t min;
 
   if( A->size < 1 ){
     fprintf( stderr, "ERROR[extractMinUList]: Heap underflow\n" );
@@ -430,7 +709,7 @@ int extractMinUList( shortList *A, int *datum1 ){
   return min;
 }
 
-void insMinUList( shortList *A, int keyVal, int datum1 ){
+void insMinUList( shortList *A, weight_t keyVal, int datum1 ){
   int i;
 
   if( A->size >= MAXQITEM ){
@@ -450,7 +729,8 @@ void insMinUList( shortList *A, int keyVal, int datum1 ){
 }
 
 void heapSortAscUList( shortList *A ){
-  int i, temp;
+  int i;
+  weight_t temp;
   int heapSize;
 
   heapSize = A->size;
@@ -468,7 +748,8 @@ void heapSortAscUList( shortList *A ){
 }
 
 void heapSortDescUList( shortList *A ){
-  int i, temp;
+  int i;
+  weight_t temp;
   int heapSize;
 
   heapSize = A->size;
@@ -490,7 +771,7 @@ void showHeapUList( shortList *A ){
 
   printf( "Heap(size=%d):\n\t", A->size );
   for( i=1, maxNode=2; i <= A->size; i++ ){
-    printf( "%d <%d> ", A->key[i], A->datum1[i] );
+    printf( "%lld <%d> ", (long long)A->key[i], A->datum1[i] );
     if( (i+1) % maxNode == 0 ){
       printf( "\n\t" );
       maxNode *= 2;
@@ -504,12 +785,155 @@ void showSList( shortList *A ){
 
   printf( "shortList(size=%d):\n\t", A->size );
   for( i=1; i <= A->size; i++ )
-    printf( "%d <%d> ", A->key[i], A->datum1[i] );
+    printf( "%lld <%d> ", (long long)A->key[i], A->datum1[i] );
   printf( "\n" );
 }
 
 /* ======================================================================= */
 
+/*
+  Sort kernels for both list types: descending key, ties by ascending
+  datum1 (the order of the heaps above). Lists are filled with appendUQ
+  / appendUList and sorted once. Up to SORT_SMALL entries use insertion
+  sort; longer lists an LSD radix sort with 8-bit digits, the datum1
+  digits first and then the key digits, skipping digits that are the
+  same for the whole list.
+*/
+
+/* digit p of an entry: 0..3 from datum1, 4..11 from key (inverted) */
+#define SORT_DIGIT(k,d,p) ((p) < 4 ? ((unsigned)(d) >> (8*(p))) & 0xFF \
+			   : 0xFF - (unsigned)(((uint64_t)(k) >> (8*((p)-4))) & 0xFF))
+
+void sortKeysDesc( weight_t *key, int *datum1, int n ){
+  weight_t tk[MAXITEMS+1], *k1, *k2, *kt, kv;
+  int td[MAXITEMS+1], *d1, *d2, *dt, dv;
+  int hist[12][256];
+  int i, j, p, pos, sum, t;
+
+  if( n <= SORT_SMALL ){
+    for( i=2; i <= n; i++ ){
+      kv = key[i];
+      dv = datum1[i];
+      for( j=i-1; j >= 1 && (key[j] < kv || (key[j] == kv && datum1[j] > dv)); j-- ){
+        key[j+1] = key[j];
+        datum1[j+1] = datum1[j];
+      }
+      key[j+1] = kv;
+      datum1[j+1] = dv;
+    }
+    return;
+  }
+
+  memset( hist, 0, sizeof(hist) );
+  for( i=1; i <= n; i++ )
+    for( p=0; p < 12; p++ )
+      hist[p][SORT_DIGIT(key[i],datum1[i],p)]++;
+
+  k1 = key; d1 = datum1;
+  k2 = tk; d2 = td;
+  for( p=0; p < 12; p++ ){
+    if( hist[p][SORT_DIGIT(k1[1],d1[1],p)] == n ) continue;
+    for( sum=1, j=0; j < 256; j++ ){
+      t = hist[p][j];
+      hist[p][j] = sum;
+      sum += t;
+    }
+    for( i=1; i <= n; i++ ){
+      pos = hist[p][SORT_DIGIT(k1[i],d1[i],p)]++;
+      k2[pos] = k1[i];
+      d2[pos] = d1[i];
+    }
+    kt = k1; k1 = k2; k2 = kt;
+    dt = d1; d1 = d2; d2 = dt;
+  }
+  if( k1 != key ){
+    memcpy( &key[1], &k1[1], n * sizeof(weight_t) );
+    memcpy( &datum1[1], &d1[1], n * sizeof(int) );
+  }
+}
+
+void appendUQ( longList *A, weight_t keyVal, int datum1 ){
+  if( A->size >= MAXQITEM || A->size >= MAXITEMS ){
+    fprintf( stderr, "ERROR[appendUQ]: List overflow\n" );
+    exit( 0 );
+  }
+  (A->size)++;
+  A->key[A->size] = keyVal;
+  A->datum1[A->size] = datum1;
+}
+
+void sortDescUQ( longList *A ){
+  sortKeysDesc( A->key, A->datum1, A->size );
+}
+
+void appendUList( shortList *A, weight_t keyVal, int datum1 ){
+  if( A->size >= MAXITEMS ){
+    fprintf( stderr, "ERROR[appendUList]: List overflow\n" );
+    exit( 0 );
+  }
+  (A->size)++;
+  A->key[A->size] = keyVal;
+  A->datum1[A->size] = datum1;
+}
+
+void sortDescUList( shortList *A ){
+  sortKeysDesc( A->key, A->datum1, A->size );
+}
+
+/* seconds on the given clock, e.g. CLOCK_MONOTONIC */
+double nowSec( clockid_t clk ){
+  struct timespec ts;
+
+  clock_gettime( clk, &ts );
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if BENCH_SORT
+/* times the heaps against the sort kernels on the same random lists */
+void benchSort( void ){
+  static longList A, B;
+  static weight_t key[MAXITEMS+1];
+  double t0, heapUs, sortUs;
+  int sizes[] = { 4, 16, 64, 256, 1024, 8192 };
+  int s, n, r, i, reps;
+
+  srand( 12345 );
+  for( s=0; s < (int)(sizeof(sizes)/sizeof(sizes[0])); s++ ){
+    n = MIN( sizes[s], MIN( MAXITEMS, MAXQITEM ) );
+    reps = MAX( 1, 2000000 / n );
+    heapUs = sortUs = 0;
+    for( r=0; r < reps; r++ ){
+      for( i=1; i <= n; i++ )
+        key[i] = (weight_t)(rand() % 1000) * WEIGHT_SCALE;
+
+      t0 = nowSec( CLOCK_MONOTONIC );
+      A.size = 0;
+      for( i=1; i <= n; i++ )
+        insMinUQ( &A, key[i], i );
+      heapSortDescUQ( &A );
+      heapUs += (nowSec( CLOCK_MONOTONIC ) - t0) * 1e6;
+
+      t0 = nowSec( CLOCK_MONOTONIC );
+      B.size = 0;
+      for( i=1; i <= n; i++ )
+        appendUQ( &B, key[i], i );
+      sortDescUQ( &B );
+      sortUs += (nowSec( CLOCK_MONOTONIC ) - t0) * 1e6;
+
+      for( i=1; i <= n; i++ )
+        if( A.key[i] != B.key[i] || A.datum1[i] != B.datum1[i] ){
+          fprintf( stderr, "ERROR[benchSort]: Orders differ at n=%d\n", n );
+          exit( 0 );
+        }
+    }
+    printf( "n=%5d  heap %8.1f ns/item  sort %8.1f ns/item\n", n,
+	    heapUs * 1000 / ((double)reps * n), sortUs * 1000 / ((double)reps * n) );
+  }
+}
+#endif
+
+/* ======================================================================= */
+
 /*
   Items are arranged according to descending frequency order.
   Only frequent and valid items are in the tree.
@@ -525,7 +949,54 @@ int numSupCnt;
 int numNodesGT, numNodesAllT;
 int isGlobal;
 
-void cleanHdr( Header *hdr ){
+/*
+  Memory budget for the trees (0 = unlimited). memUsed counts the tree
+  nodes, their weight vectors, the infos and the pair matrices. A
+  projection that would push it over memBudget is spilled to a temp file
+  and mined after the in-memory recursion has unwound. With -e it also
+  bounds the runs the edges are sorted in.
+*/
+long memBudget;
+__thread long memUsed;
+
+/* conditional bases with at most this many path nodes are pseudo-projected */
+int pseudoMax;
+
+/* number of transactions, the universe of the PersonalInfo sets */
+int infoUniverse;
+__thread FILE *spillFp;		/* partitions are appended here */
+__thread FILE *spillSpare;	/* the other spill file: being read, or empty */
+__thread SpillPart *spillHead, *spillTail;
+__thread int numSpilled;
+__thread long spillBytes;
+
+/*
+  Scratch of the FPgrowth / pseudoGrowth activations, one frame per
+  recursion depth. Frames are allocated the first time a depth is
+  reached and reused by every later activation at that depth, so deep
+  recursion does not grow the stack. Counters are cleared only for the
+  header items that are about to be counted.
+*/
+__thread GrowFrame **framePool;
+__thread int framePoolLen;
+__thread int frameDepth;
+
+/*
+  Top-level branches FPgrowth mines: header positions from growFloor
+  down, and of those only the ones set in growOnly (NULL = all). The
+  skipped ones below growFloor still pass their info up.
+*/
+__thread int growFloor = 1;
+__thread char *growOnly;
+/*
+  The top-level tree is the server's resident one, settled: its nodes
+  already hold what passInfoUp would give them, so FPgrowth only reads
+  it and the connection threads share it.
+*/
+__thread int growShared;
+
+/* full reset, for a header that has never been used */
+void initHdr( Header *hdr ){
   int i;
 
   hdr->hdrLen = 0;
@@ -537,9 +1008,38 @@ void cleanHdr( Header *hdr ){
     hdr->tail[i] = NULL;
     hdr->mapHdr[i] = 0;
   }
+  hdr->block = NULL;
+  hdr->blockLen = 0;
+  hdr->pair = NULL;
+  hdr->pairCap = 0;
+  hdr->pairs = FALSE;
+  hdr->cells = 0;
+}
+
+/* empties an initialized header; insertHdr sets the rest of each entry */
+void cleanHdr( Header *hdr ){
+  int i;
+
+  for( i=1; i <= hdr->hdrLen; i++ )
+    hdr->mapHdr[hdr->item[i]] = 0;
+  hdr->hdrLen = 0;
+  hdr->block = NULL;
+  hdr->blockLen = 0;
+  hdr->pairs = FALSE;
+  hdr->cells = 0;
+}
+
+/* releases the pair matrix of a header that is no longer used */
+void freePairs( Header *hdr ){
+  memUsed -= hdr->pairCap * (long)sizeof(weight_t);
+  free( hdr->pair );
+  hdr->pair = NULL;
+  hdr->pairCap = 0;
+  hdr->pairs = FALSE;
+  hdr->cells = 0;
 }
 
-TreeNode *createNewNode( int item, int count ){
+TreeNode *createNewNode( int item, weight_t count ){
   TreeNode *N;
 
   N = (TreeNode *)malloc( sizeof(TreeNode) );
@@ -547,8 +1047,14 @@ TreeNode *createNewNode( int item, int count ){
     fprintf( stderr, "ERROR[createNode]\n" );
     exit( 0 );
   }
+  memUsed += sizeof(TreeNode);
+  nodesMade++;
   N->item = item;
+  N->depth = 0;
   N->count = count;
+  N->aw = 0;
+  N->wv = NULL;
+  N->bound = 0;
   N->info = NULL;
   N->nodeLink = NULL;
   N->parent = NULL;
@@ -559,147 +1065,998 @@ TreeNode *createNewNode( int item, int count ){
   return N;
 }
 
-PersonalInfo *create_info(int item){
+/* item weights by depth, allocated on first use */
+weight_t *nodeWeights( TreeNode *N ){
+  int j;
+
+  if( N->wv == NULL ){
+    N->wv = (weight_t *)malloc( (N->depth + 1) * sizeof(weight_t) );
+    if( N->wv == NULL ){
+      fprintf( stderr, "ERROR[nodeWeights]\n" );
+      exit( 0 );
+    }
+    for( j=0; j < N->depth; j++ )
+      N->wv[j] = 0;
+    memUsed += (N->depth + 1) * sizeof(weight_t);
+  }
+  return N->wv;
+}
+
+void releaseWeights( TreeNode *N ){
+  if( N->wv != NULL ){
+    free( N->wv );
+    memUsed -= (N->depth + 1) * sizeof(weight_t);
+    N->wv = NULL;
+  }
+}
+
+/*
+  Infos are reference counted. Tree nodes, candidate itemsets and the
+  caller that created an info each hold one reference; sharing an info
+  only takes a reference, and combine_info copies a shared parent before
+  changing it. freeTree drops the references of the nodes it frees.
+  Counts are atomic: server threads share the infos of the resident tree.
+
+  A set of transactions (1..infoUniverse) is kept as a sorted vector of
+  indices while it is small, and as a bitmap over the universe once the
+  vector would take more room (size > infoUniverse / 32).
+*/
+#define INFO_WORDS	((infoUniverse >> 6) + 1)
+#define INFO_DENSE(n)	((n) > (infoUniverse >> 5))
+#define INFO_BYTES(P)	((long)sizeof(PersonalInfo) + (long)(P)->cap * (long)sizeof(int) + \
+			 ((P)->words != NULL ? (long)INFO_WORDS * (long)sizeof(uint64_t) : 0))
+
+PersonalInfo *new_info(void){
 	PersonalInfo *P;
-	
+
 	P = (PersonalInfo *)malloc(sizeof(PersonalInfo));
 	if(P == NULL){
-		fprintf(stderr, "ERROR[create_info]\n");
+		fprintf(stderr, "ERROR[new_info]\n");
 		exit(0);
 	}
-	int i;
-	for(i = 1; i <= MAXITEMS; i ++){
-		P->friends[i] = 0;
-	}
-	P->friends[item] = 1;
+	P->refs = 1;
+	P->size = 0;
+	P->cap = 0;
+	P->tids = NULL;
+	P->words = NULL;
+	memUsed += sizeof(PersonalInfo);
 	return P;
 }
 
-PersonalInfo *create_info_copy(PersonalInfo *child){
-	PersonalInfo *P;
-	
-	P = (PersonalInfo *)malloc(sizeof(PersonalInfo));
-	if(P == NULL){
-		fprintf(stderr, "ERROR[create_info_copy]\n");
+/* bitmap of P, uninitialized, charged to memUsed */
+void info_alloc_words(PersonalInfo *P){
+
+	P->words = (uint64_t *)malloc(INFO_WORDS * sizeof(uint64_t));
+	if(P->words == NULL){
+		fprintf(stderr, "ERROR[info_alloc_words]\n");
+		exit(0);
+	}
+	memUsed += INFO_WORDS * sizeof(uint64_t);
+}
+
+void info_reserve(PersonalInfo *P, int cap){
+
+	if(cap <= P->cap){
+		return;
+	}
+	P->tids = (int *)realloc(P->tids, cap * sizeof(int));
+	if(P->tids == NULL){
+		fprintf(stderr, "ERROR[info_reserve]\n");
 		exit(0);
 	}
+	memUsed += (long)(cap - P->cap) * sizeof(int);
+	P->cap = cap;
+}
+
+void info_to_dense(PersonalInfo *P){
 	int i;
-	for(i = 1; i <= MAXITEMS; i ++){
-		if(child->friends[i] == 1){
-			P->friends[i] = 1;
-		}
-		else{
-			P->friends[i] = 0;
-		}
+
+	info_alloc_words(P);
+	memset(P->words, 0, INFO_WORDS * sizeof(uint64_t));
+	for(i = 0; i < P->size; i ++){
+		P->words[P->tids[i] >> 6] |= (uint64_t)1 << (P->tids[i] & 63);
 	}
+	free(P->tids);
+	memUsed -= (long)P->cap * sizeof(int);
+	P->tids = NULL;
+	P->cap = 0;
+}
 
+PersonalInfo *create_info(int item){
+	PersonalInfo *P = new_info();
+
+	info_reserve(P, 1);
+	P->tids[0] = item;
+	P->size = 1;
 	return P;
 }
 
-void insert_friend(PersonalInfo *P, int friend){
-	
-	P->friends[friend] = 1;
-}
+PersonalInfo *retain_info(PersonalInfo *P){
 
-void combine_info(PersonalInfo *child, PersonalInfo *parent){
-	
-	int i;
-	for(i = 1; i <= MAXITEMS; i ++){
-		if(child->friends[i] == 1){
-			parent->friends[i] = 1;
-		}
+	if(P != NULL){
+		__atomic_add_fetch(&P->refs, 1, __ATOMIC_RELAXED);
 	}
+	return P;
 }
 
-void showFP( int headItem, shortList *tail, int count, TreeNode *head ){
-  int i;
+void release_info(PersonalInfo *P){
 
-  printf( "FP%d: ", 1 + tail->size );
-  printf( "%d ", headItem );
-  for( i=1; i <= tail->size; i++ ){
-    printf( "%d ", tail->datum1[i] );
-  }
-  /*
-  printf( "(%d)  ", count );
-  
-  TreeNode *node = head;
-  while(node != NULL && node->info != NULL){
-  	PersonalInfo *P = node->info;
-  	for(i = 1; i <= MAXITEMS; i ++){
-  		if(P->friends[i] == 1){
-  			printf("%d ", i);
-  		}
-  	}
-  	node = node->nodeLink;
-  }
-  */
-  printf("\n");
+	if(P != NULL && __atomic_sub_fetch(&P->refs, 1, __ATOMIC_ACQ_REL) == 0){
+		memUsed -= INFO_BYTES(P);
+		free(P->tids);
+		free(P->words);
+		free(P);
+	}
 }
 
-void storeFP(int headItem, shortList *tail, int count, TreeNode *head){
-
-  int i;
-  init_itemset(&FP[sizeFP]);
-  FP[sizeFP].items[headItem] = 1;
-  for( i=1; i <= tail->size; i++ ){
-    FP[sizeFP].items[tail->datum1[i]] = 1;
-  }
-  FP[sizeFP].climp = count;
-  TreeNode *node = head;
-  while(node != NULL && node->info != NULL){
-  	if(FP[sizeFP].info == NULL){
-  		PersonalInfo *P = create_info_copy(node->info);
-  		FP[sizeFP].info = P;
-  	}
-  	else{
-  		combine_info(node->info, FP[sizeFP].info);
-  	}
-  	node = node->nodeLink;
-  }
-  sizeFP ++;
-  if(sizeFP == MAXITEMSETS){
-  	printf("\nNEED TO INCREASE MAXITEMSETS");
-  	exit(-1);
-  }
+PersonalInfo *create_info_copy(PersonalInfo *child){
+	PersonalInfo *P = new_info();
 
+	P->size = child->size;
+	if(child->words != NULL){
+		info_alloc_words(P);
+		memcpy(P->words, child->words, INFO_WORDS * sizeof(uint64_t));
+	}
+	else if(child->size > 0){
+		info_reserve(P, child->size);
+		memcpy(P->tids, child->tids, child->size * sizeof(int));
+	}
+	return P;
 }
 
-double get_dgimp(int items[], Transaction *T){
-	
-	int i;
-	double dgimp = 0;
-	for(i = 1; i <= MAXITEMS; i ++){
-		if(T->itemset[i] > 0 && items[i] == 1){
-			dgimp += T->itemset[i];
-		}	
+/* TRUE if transaction friend is in P */
+boolean info_has(PersonalInfo *P, int friend){
+	int lo, hi, mid;
+
+	if(P->words != NULL){
+		return ((P->words[friend >> 6] >> (friend & 63)) & 1) ? true : false;
 	}
-	return dgimp;
+	lo = 0;
+	hi = P->size - 1;
+	while(lo <= hi){
+		mid = (lo + hi) / 2;
+		if(P->tids[mid] == friend){
+			return true;
+		}
+		if(P->tids[mid] < friend){
+			lo = mid + 1;
+		}
+		else{
+			hi = mid - 1;
+		}
+	}
+	return false;
 }
 
-boolean in_transaction(int items[], Transaction *T){
+/* adds child to parent; returns parent, or its private copy if it was shared */
+PersonalInfo *combine_info(PersonalInfo *child, PersonalInfo *parent){
 	
-	boolean result = true;
-	int i;
-	for(i = 1; i <= MAXITEMS && result == true; i ++){
-		if(items[i] == 1 && T->itemset[i] == 0){
-			result = false;
+	int i, j, n, w;
+	int *merged;
+	PersonalInfo *P;
+
+	if(child == parent || child->size == 0){	//nothing to add
+		return parent;
+	}
+	if(__atomic_load_n(&parent->refs, __ATOMIC_ACQUIRE) > 1){
+		P = create_info_copy(parent);
+		release_info(parent);
+		parent = P;
+	}
+	if(parent->words == NULL && INFO_DENSE(parent->size + child->size)){
+		info_to_dense(parent);
+	}
+	if(parent->words != NULL){
+		if(child->words != NULL){
+			for(w = 0, n = 0; w < INFO_WORDS; w ++){
+				parent->words[w] |= child->words[w];
+				n += __builtin_popcountll(parent->words[w]);
+			}
+			parent->size = n;
+		}
+		else{
+			for(i = 0; i < child->size; i ++){
+				w = child->tids[i] >> 6;
+				if(! ((parent->words[w] >> (child->tids[i] & 63)) & 1)){
+					parent->words[w] |= (uint64_t)1 << (child->tids[i] & 63);
+					parent->size ++;
+				}
+			}
+		}
+		return parent;
+	}
+
+	/* both sparse: merge the sorted vectors */
+	merged = (int *)malloc((size_t)(parent->size + child->size) * sizeof(int));
+	if(merged == NULL){
+		fprintf(stderr, "ERROR[combine_info]\n");
+		exit(0);
+	}
+	for(i = 0, j = 0, n = 0; i < parent->size || j < child->size; ){
+		if(j >= child->size || (i < parent->size && parent->tids[i] < child->tids[j])){
+			merged[n ++] = parent->tids[i ++];
+		}
+		else if(i >= parent->size || child->tids[j] < parent->tids[i]){
+			merged[n ++] = child->tids[j ++];
+		}
+		else{
+			merged[n ++] = parent->tids[i ++];
+			j ++;
 		}
 	}
-	return result;
+	free(parent->tids);
+	memUsed += (long)(parent->size + child->size - parent->cap) * sizeof(int);
+	parent->tids = merged;
+	parent->cap = parent->size + child->size;
+	parent->size = n;
+	return parent;
 }
 
-void sortList( shortList *oList, shortList *sList, Counter *c ){
-  int i;
-  longList Q;
+/* adds friend, larger than every friend in P; P must not be shared */
+void append_friend(PersonalInfo *P, int friend){
+
+	if(P->words == NULL && INFO_DENSE(P->size + 1)){
+		info_to_dense(P);
+	}
+	if(P->words != NULL){
+		P->words[friend >> 6] |= (uint64_t)1 << (friend & 63);
+	}
+	else{
+		if(P->size == P->cap){
+			info_reserve(P, P->cap < 4 ? 4 : 2 * P->cap);
+		}
+		P->tids[P->size] = friend;
+	}
+	P->size ++;
+}
+
+/* ======================================================================= */
+
+/* sets the transactions of P in words (INFO_WORDS long) */
+void info_mark(PersonalInfo *P, uint64_t *words){
+	int i;
+
+	if(P->words != NULL){
+		for(i = 0; i < INFO_WORDS; i ++){
+			words[i] |= P->words[i];
+		}
+		return;
+	}
+	for(i = 0; i < P->size; i ++){
+		words[P->tids[i] >> 6] |= (uint64_t)1 << (P->tids[i] & 63);
+	}
+}
+
+/* new info with the transactions set in words, which are cleared */
+PersonalInfo *info_from_words(uint64_t *words){
+	PersonalInfo *P = new_info();
+	uint64_t x;
+	int w, n = 0;
+
+	for(w = 0; w < INFO_WORDS; w ++){
+		n += __builtin_popcountll(words[w]);
+	}
+	if(INFO_DENSE(n)){
+		info_alloc_words(P);
+		memcpy(P->words, words, INFO_WORDS * sizeof(uint64_t));
+		memset(words, 0, INFO_WORDS * sizeof(uint64_t));
+	}
+	else{
+		info_reserve(P, n > 0 ? n : 1);
+		for(w = 0; w < INFO_WORDS; w ++){
+			for(x = words[w]; x != 0; x &= x - 1){
+				P->tids[P->size ++] = (w << 6) + __builtin_ctzll(x);
+			}
+			words[w] = 0;
+		}
+	}
+	P->size = n;
+	return P;
+}
+
+/* ======================================================================= */
+
+/*
+  Buffered output of the significant friend groups. Each group goes to
+  the output file in the chosen format and, unless echo is off, as text
+  to stdout. Formats:
+    OUT_TEXT    "\n{ a b c }", as printed on stdout
+    OUT_NDJSON  one object per line: items, climp, dgimp, ratio
+                (dgimp / limp(DB)) and friends (transaction numbers)
+    OUT_BINARY  "SFT1", then per group: int32 nItems, nItems int32,
+                int64 climp, int64 dgimp (1/WEIGHT_SCALE units), int32
+                nFriends, nFriends int32; native byte order
+*/
+
+void obFlush( OutBuf *B ){
+  if( B->len > 0 && fwrite( B->buf, 1, B->len, B->fp ) != B->len ){
+    fprintf( stderr, "ERROR[obFlush]: Write failed\n" );
+    exit( 0 );
+  }
+  B->len = 0;
+}
+
+void obWrite( OutBuf *B, const void *data, size_t size ){
+  if( B->len + size > OUT_BUF_SIZE )
+    obFlush( B );
+  if( size > OUT_BUF_SIZE ){
+    B->len = 0;
+    if( fwrite( data, 1, size, B->fp ) != size ){
+      fprintf( stderr, "ERROR[obWrite]: Write failed\n" );
+      exit( 0 );
+    }
+    return;
+  }
+  memcpy( B->buf + B->len, data, size );
+  B->len += size;
+}
+
+void obPuts( OutBuf *B, const char *str ){
+  obWrite( B, str, strlen( str ) );
+}
+
+void obInt( OutBuf *B, long long v ){
+  char tmp[24];
+  int n = 0, neg = (v < 0);
+  unsigned long long u = neg ? -(unsigned long long)v : (unsigned long long)v;
+
+  do{
+    tmp[sizeof(tmp) - 1 - n++] = '0' + (u % 10);
+    u /= 10;
+  }while( u > 0 );
+  if( neg ) tmp[sizeof(tmp) - 1 - n++] = '-';
+  obWrite( B, tmp + sizeof(tmp) - n, n );
+}
+
+/* fixed-point weight, exact */
+void obWeight( OutBuf *B, weight_t w ){
+  char tmp[8];
+  weight_t frac;
+  int i;
+
+  if( w < 0 ){
+    obPuts( B, "-" );
+    w = -w;
+  }
+  obInt( B, w / WEIGHT_SCALE );
+  frac = w % WEIGHT_SCALE;
+  tmp[0] = '.';
+  for( i = 4; i >= 1; i--, frac /= 10 )
+    tmp[i] = '0' + (frac % 10);
+  obWrite( B, tmp, 5 );
+}
+
+void openWriter( OutWriter *W, FILE *fp, int format, int echo ){
+  W->format = format;
+  W->echo = echo;
+  W->file.fp = fp;
+  W->file.len = 0;
+  W->file.buf = (char *)malloc( OUT_BUF_SIZE );
+  W->out.fp = stdout;
+  W->out.len = 0;
+  W->out.buf = (char *)malloc( OUT_BUF_SIZE );
+  if( W->file.buf == NULL || W->out.buf == NULL ){
+    fprintf( stderr, "ERROR[openWriter]\n" );
+    exit( 0 );
+  }
+  if( format == OUT_BINARY )
+    obWrite( &W->file, "SFT1", 4 );
+}
+
+void flushWriter( OutWriter *W ){
+  obFlush( &W->file );
+  obFlush( &W->out );
+}
+
+void closeWriter( OutWriter *W ){
+  flushWriter( W );
+  free( W->file.buf );
+  free( W->out.buf );
+}
+
+void textItemset( OutBuf *B, Itemset *I ){
+  int i;
+
+  obPuts( B, "\n{ " );
+  for( i = 0; i < I->len; i++ ){
+    obInt( B, FP_ITEMS( I )[i] );
+    obPuts( B, " " );
+  }
+  obPuts( B, "}" );
+}
+
+void writeItemset( OutWriter *W, Itemset *I, weight_t dlimpDB ){
+  char tmp[32];
+  int32_t n, v;
+  int i, w, first;
+  uint64_t bits;
+  PersonalInfo *P = I->info;
+
+  if( W->echo )
+    textItemset( &W->out, I );
+
+  if( W->format == OUT_TEXT ){
+    textItemset( &W->file, I );
+  }else if( W->format == OUT_NDJSON ){
+    obPuts( &W->file, "{\"items\":[" );
+    for( i = 0; i < I->len; i++ ){
+      if( i > 0 ) obPuts( &W->file, "," );
+      obInt( &W->file, FP_ITEMS( I )[i] );
+    }
+    obPuts( &W->file, "],\"climp\":" );
+    obWeight( &W->file, I->climp );
+    obPuts( &W->file, ",\"dgimp\":" );
+    obWeight( &W->file, I->dgimp );
+    snprintf( tmp, sizeof(tmp), ",\"ratio\":%.6g", dlimpDB > 0 ? (double)I->dgimp / dlimpDB : 0.0 );
+    obPuts( &W->file, tmp );
+    obPuts( &W->file, ",\"friends\":[" );
+    first = 1;
+    if( P != NULL && P->words != NULL ){
+      for( w = 0; w <= (infoUniverse >> 6); w ++ )
+        for( bits = P->words[w]; bits != 0; bits &= bits - 1 ){
+          if( ! first ) obPuts( &W->file, "," );
+          obInt( &W->file, 64 * w + __builtin_ctzll( bits ) );
+          first = 0;
+        }
+    }else if( P != NULL ){
+      for( i = 0; i < P->size; i ++ ){
+        if( ! first ) obPuts( &W->file, "," );
+        obInt( &W->file, P->tids[i] );
+        first = 0;
+      }
+    }
+    obPuts( &W->file, "]}\n" );
+  }else{
+    n = I->len;
+    obWrite( &W->file, &n, sizeof(n) );
+    obWrite( &W->file, FP_ITEMS( I ), n * sizeof(int32_t) );
+    obWrite( &W->file, &I->climp, sizeof(weight_t) );
+    obWrite( &W->file, &I->dgimp, sizeof(weight_t) );
+    n = (P == NULL ? 0 : P->size);
+    obWrite( &W->file, &n, sizeof(n) );
+    if( P != NULL && P->words != NULL ){
+      for( w = 0; w <= (infoUniverse >> 6); w ++ )
+        for( bits = P->words[w]; bits != 0; bits &= bits - 1 ){
+          v = 64 * w + __builtin_ctzll( bits );
+          obWrite( &W->file, &v, sizeof(v) );
+        }
+    }else if( P != NULL && P->size > 0 ){
+      obWrite( &W->file, P->tids, P->size * sizeof(int32_t) );
+    }
+  }
+}
+
+/* text notes (timings, totals) go to the output file only in text format */
+void writeNote( OutWriter *W, const char *fmt, ... ){
+  char tmp[512];
+  va_list ap;
+
+  if( W->format != OUT_TEXT ) return;
+  va_start( ap, fmt );
+  vsnprintf( tmp, sizeof(tmp), fmt, ap );
+  va_end( ap );
+  obPuts( &W->file, tmp );
+}
+
+/* ======================================================================= */
+
+/*
+  Phase timer. phaseBegin / phaseEnd bracket a phase; a phase begun
+  inside another is its child, and beginning a phase again under the
+  same parent adds to it. Wall time is CLOCK_MONOTONIC. With -T the CPU
+  time of the process and the peak RSS are sampled at both ends too.
+  phaseReport prints every phase once mining is over.
+*/
+__thread Phase phases[MAX_PHASES];
+__thread int numPhases;
+__thread int phaseStack[MAX_PHASE_DEPTH];
+__thread int phaseTop;
+int timerDetail;
+
+long peakRssKB( void ){
+  struct rusage ru;
+
+  if( getrusage( RUSAGE_SELF, &ru ) != 0 ) return 0;
+  return ru.ru_maxrss;
+}
+
+void phaseBegin( const char *name ){
+  int i, parent;
+  Phase *P;
+
+  parent = (phaseTop > 0 && phaseTop <= MAX_PHASE_DEPTH) ? phaseStack[phaseTop-1] : -1;
+  for( i=0; i < numPhases; i++ )
+    if( phases[i].parent == parent && strcmp( phases[i].name, name ) == 0 )
+      break;
+  if( i == numPhases ){
+    if( numPhases < MAX_PHASES ){
+      P = &phases[numPhases++];
+      memset( P, 0, sizeof(Phase) );
+      snprintf( P->name, sizeof(P->name), "%s", name );
+      P->parent = parent;
+    }else{
+      i = -1;	// table full: not timed
+    }
+  }
+  if( phaseTop < MAX_PHASE_DEPTH )
+    phaseStack[phaseTop] = i;
+  phaseTop++;
+  if( i >= 0 ){
+    phases[i].start = nowSec( CLOCK_MONOTONIC );
+    if( timerDetail )
+      phases[i].cpuStart = nowSec( CLOCK_PROCESS_CPUTIME_ID );
+  }
+}
+
+void phaseEnd( void ){
+  Phase *P;
+  long rss;
+
+  phaseTop--;
+  if( phaseTop >= MAX_PHASE_DEPTH || phaseStack[phaseTop] < 0 ) return;
+  P = &phases[phaseStack[phaseTop]];
+  P->wall += nowSec( CLOCK_MONOTONIC ) - P->start;
+  P->calls++;
+  if( timerDetail ){
+    P->cpu += nowSec( CLOCK_PROCESS_CPUTIME_ID ) - P->cpuStart;
+    rss = peakRssKB();
+    if( rss > P->rssKB ) P->rssKB = rss;
+  }
+}
+
+void phaseReportRec( OutWriter *W, int parent, int level ){
+  char line[256];
+  int i, n;
+
+  for( i=0; i < numPhases; i++ ){
+    if( phases[i].parent != parent ) continue;
+    if( level == 0 )
+      n = snprintf( line, sizeof(line), "\n[SF-Tree] Total runtime for %s is %ld sec. %.3f msec",
+		    phases[i].name, (long)phases[i].wall, fmod( phases[i].wall, 1.0 ) * 1000.0 );
+    else
+      n = snprintf( line, sizeof(line), "\n[SF-Tree] %*s%s: %.3f msec in %ld calls",
+		    2 * level, "", phases[i].name, phases[i].wall * 1000.0, phases[i].calls );
+    if( timerDetail && n < (int)sizeof(line) )
+      snprintf( line + n, sizeof(line) - n, " (cpu %.3f msec, peak RSS %ld KB)",
+		phases[i].cpu * 1000.0, phases[i].rssKB );
+    printf( "%s\n", line );
+    writeNote( W, "%s\n", line );
+    phaseReportRec( W, i, level + 1 );
+  }
+}
+
+/* every phase, nested ones indented, then the sum of the top-level ones */
+void phaseReport( OutWriter *W ){
+  double total = 0;
+  int i;
+
+  phaseReportRec( W, -1, 0 );
+  for( i=0; i < numPhases; i++ )
+    if( phases[i].parent == -1 )
+      total += phases[i].wall;
+  printf( "\n[SF-Tree] Total (aggregate) runtime is %ld sec. %.3f msec\n", (long)total, fmod( total, 1.0 ) * 1000.0 );
+  writeNote( W, "\n[SF-Tree] Total (aggregate) runtime is %ld sec. %.3f msec\n", (long)total, fmod( total, 1.0 ) * 1000.0 );
+}
+
+/* ======================================================================= */
+
+/*
+  Regression checks. -g compares the groups found against the groups of
+  an earlier text output file (the golden file); -B saves the top-level
+  phase times and peak RSS of this run and -b compares them against a
+  saved baseline, failing a phase that is slower or larger than
+  tolerance percent (-r) plus a small absolute slack. main exits with 1
+  when a check fails so a script can gate an optimized build on it.
+*/
+int cmpGroupKey( const void *a, const void *b ){
+  return strcmp( *(char * const *)a, *(char * const *)b );
+}
+
+/* "1 5 9" for the items of a group */
+char *groupKey( Itemset *I ){
+  char buf[GROUP_KEY_MAX];
+  int i, n = 0;
+
+  buf[0] = '\0';
+  for( i = 0; i < I->len && n < GROUP_KEY_MAX - 12; i++ )
+    n += snprintf( buf + n, GROUP_KEY_MAX - n, n ? " %d" : "%d", FP_ITEMS( I )[i] );
+  return strdup( buf );
+}
+
+/*
+  groups of a text output file: every "{ a b c }" after the "Found
+  ShFrequent Itemsets:" note, which only text output has. NULL if the
+  file can't be read or is not text output.
+*/
+char **readGolden( const char *file, int *size ){
+  FILE *fp;
+  char **keys = NULL;
+  char buf[GROUP_KEY_MAX];
+  int c, n, cap = 0, item, inGroup = FALSE, isText = FALSE;
+
+  if( (fp = fopen( file, "r" )) == NULL ){
+    fprintf( stderr, "ERROR[readGolden]: Can't open %s\n", file );
+    return NULL;
+  }
+  while( ! isText && fgets( buf, sizeof(buf), fp ) != NULL )
+    isText = (strstr( buf, "Found ShFrequent Itemsets:" ) != NULL);
+  if( ! isText ){
+    fprintf( stderr, "ERROR[readGolden]: %s is not a text output file\n", file );
+    fclose( fp );
+    return NULL;
+  }
+  *size = 0;
+  n = 0;
+  while( (c = fgetc( fp )) != EOF ){
+    if( c == '{' ){
+      inGroup = TRUE;
+      n = 0;
+      buf[0] = '\0';
+    }else if( inGroup && c == '}' ){
+      if( *size == cap ){
+        cap = cap ? 2 * cap : 256;
+        keys = realloc( keys, cap * sizeof(char *) );
+        if( keys == NULL ){
+          fprintf( stderr, "ERROR[readGolden]: Out of memory\n" );
+          exit( 0 );
+        }
+      }
+      keys[(*size)++] = strdup( buf );
+      inGroup = FALSE;
+    }else if( inGroup && c >= '0' && c <= '9' ){
+      ungetc( c, fp );
+      if( fscanf( fp, "%d", &item ) == 1 && n < GROUP_KEY_MAX - 12 )
+        n += snprintf( buf + n, GROUP_KEY_MAX - n, n ? " %d" : "%d", item );
+    }
+  }
+  if( keys == NULL )	// no groups: an empty list, not a failure
+    keys = (char **)malloc( sizeof(char *) );
+  fclose( fp );
+  return keys;
+}
+
+/* number of groups missing from or extra to the golden file */
+int checkGolden( const char *file, weight_t minClimp ){
+  char **gold, **got;
+  int i, j, k, numGold, numGot = 0, missing = 0, extra = 0, cmp;
+
+  if( (gold = readGolden( file, &numGold )) == NULL ){
+    printf( "\n[SF-Tree] golden %s: unreadable: FAIL\n", file );
+    return 1;
+  }
+  got = malloc( (sizeFP + 1) * sizeof(char *) );
+  for( i = 0; i < sizeFP; i ++ )
+    if( FP[i].dgimp >= minClimp )
+      got[numGot++] = groupKey( &FP[i] );
+  qsort( gold, numGold, sizeof(char *), cmpGroupKey );
+  qsort( got, numGot, sizeof(char *), cmpGroupKey );
+
+  for( i = 0, j = 0; i < numGold || j < numGot; ){
+    cmp = (i == numGold) ? 1 : (j == numGot) ? -1 : strcmp( gold[i], got[j] );
+    if( cmp < 0 ){
+      if( missing + extra < GOLDEN_SHOW ) printf( "\n[SF-Tree] golden: missing { %s }", gold[i] );
+      missing ++;
+      i ++;
+    }else if( cmp > 0 ){
+      if( missing + extra < GOLDEN_SHOW ) printf( "\n[SF-Tree] golden: extra { %s }", got[j] );
+      extra ++;
+      j ++;
+    }else{
+      i ++;
+      j ++;
+    }
+  }
+  printf( "\n[SF-Tree] golden %s: %d groups expected, %d found, %d missing, %d extra: %s\n",
+	  file, numGold, numGot, missing, extra, (missing + extra) ? "FAIL" : "ok" );
+
+  for( k = 0; k < numGold; k ++ ) free( gold[k] );
+  for( k = 0; k < numGot; k ++ ) free( got[k] );
+  free( gold );
+  free( got );
+  return missing + extra;
+}
+
+/* one line per top-level phase: wall seconds, peak RSS in KB, name */
+int writeBaseline( const char *file ){
+  FILE *fp;
+  int i;
+
+  if( (fp = fopen( file, "w" )) == NULL ){
+    fprintf( stderr, "ERROR[writeBaseline]: Can't open %s\n", file );
+    return 1;
+  }
+  for( i = 0; i < numPhases; i ++ )
+    if( phases[i].parent == -1 )
+      fprintf( fp, "%.6f %ld %s\n", phases[i].wall, phases[i].rssKB, phases[i].name );
+  return fclose( fp ) != 0;
+}
+
+/* number of phases slower or larger than the baseline allows */
+int checkBaseline( const char *file, double tolerance ){
+  FILE *fp;
+  char name[64];
+  double wall, limit;
+  long rss, rssLimit;
+  int i, fail = 0;
+
+  if( (fp = fopen( file, "r" )) == NULL ){
+    fprintf( stderr, "ERROR[checkBaseline]: Can't open %s\n", file );
+    printf( "\n[SF-Tree] baseline %s: unreadable: FAIL\n", file );
+    return 1;
+  }
+  while( fscanf( fp, "%lf %ld %63[^\n]", &wall, &rss, name ) == 3 ){
+    for( i = 0; i < numPhases; i ++ )
+      if( phases[i].parent == -1 && strcmp( phases[i].name, name ) == 0 )
+        break;
+    if( i == numPhases ) continue;	// phase not run this time, e.g. no -s
+    limit = wall * (1 + tolerance / 100) + REGRESS_SLACK_SEC;
+    rssLimit = (long)(rss * (1 + tolerance / 100)) + REGRESS_SLACK_KB;
+    if( phases[i].wall > limit || phases[i].rssKB > rssLimit ){
+      printf( "\n[SF-Tree] baseline: %s took %.3f msec and %ld KB, allowed %.3f msec and %ld KB: FAIL",
+	      name, phases[i].wall * 1000.0, phases[i].rssKB, limit * 1000.0, rssLimit );
+      fail ++;
+    }
+  }
+  fclose( fp );
+  printf( "\n[SF-Tree] baseline %s within %.0f%%: %s\n", file, tolerance, fail ? "FAIL" : "ok" );
+  return fail;
+}
+
+/* ======================================================================= */
+
+void showFP( int headItem, shortList *tail, weight_t count, TreeNode *head ){
+  int i;
+
+  printf( "FP%d: ", 1 + tail->size );
+  printf( "%d ", headItem );
+  for( i=1; i <= tail->size; i++ ){
+    printf( "%d ", tail->datum1[i] );
+  }
+  /*
+  printf( "(%d)  ", count );
+  
+  TreeNode *node = head;
+  while(node != NULL && node->info != NULL){
+  	PersonalInfo *P = node->info;
+  	for(i = 1; i <= infoUniverse; i ++){
+  		if(info_has(P, i) == true){
+  			printf("%d ", i);
+  		}
+  	}
+  	node = node->nodeLink;
+  }
+  */
+  printf("\n");
+}
+
+Itemset *newFP(int headItem, shortList *tail, weight_t count){
+
+  int i;
+  Itemset *I = openFP();
+  add_item(I, headItem);
+  for( i=1; i <= tail->size; i++ ){
+    add_item(I, tail->datum1[i]);
+  }
+  I->climp = count;
+  closeFP(I);
+  return I;
+}
+
+void addFPInfo(Itemset *I, PersonalInfo *info){
+
+  if(info == NULL){
+  	return;
+  }
+  if(I->info == NULL){
+  	I->info = retain_info(info);
+  }
+  else{
+  	I->info = combine_info(info, I->info);
+  }
+}
+
+/* TRUE if the ascending items a[0..na) are all in b[0..nb) */
+boolean sub_items(int *a, int na, int *b, int nb){
+
+	int i, j = 0;
+	if(na > nb){
+		return false;
+	}
+	for(i = 0; i < na; i ++){
+		while(j < nb && b[j] < a[i]){
+			j ++;
+		}
+		if(j == nb || b[j] != a[i]){
+			return false;
+		}
+		j ++;
+	}
+	return true;
+}
+
+/* TRUE if every item of A is also in B */
+boolean sub_itemset(Itemset *A, Itemset *B){
+
+#if ITEM_MASK
+	return (A->mask & ~B->mask) ? false : true;
+#else
+	return sub_items(FP_ITEMS(A), A->len, FP_ITEMS(B), B->len);
+#endif
+}
+
+/*
+  The list holding every stored superset of the n items a: the shortest
+  of their item lists, or the climp bucket in closed mode. NULL when
+  nothing is indexed.
+*/
+FPList *supersetsFP(int *a, int n, weight_t climp){
+
+	FPList *L = NULL;
+	int i;
+	if(fpByItem == NULL){
+		return NULL;
+	}
+	if(mineMode == MINE_CLOSED){
+		L = &fpByClimp[CLIMP_BUCKET(climp)];
+	}
+	for(i = 0; i < n; i ++){
+		if(L == NULL || fpByItem[a[i]].size < L->size){
+			L = &fpByItem[a[i]];
+		}
+	}
+	return L;
+}
+
+/*
+  TRUE if a stored pattern makes the items S of len n (any order)
+  redundant: a superset with the same climp (closed mode) or any
+  superset (maximal mode).
+*/
+boolean subsumedFP(int *S, int n, weight_t climp){
+
+	FPList *L;
+	int i, j, k;
+#if ITEM_MASK
+	itemmask_t mask = 0;
+	for(i = 0; i < n; i ++){
+		mask |= ITEM_BIT(S[i]);
+	}
+#else
+	int x;
+	for(i = 1; i < n; i ++){
+		x = S[i];
+		for(j = i; j > 0 && S[j-1] > x; j --){
+			S[j] = S[j-1];
+		}
+		S[j] = x;
+	}
+#endif
+	L = supersetsFP(S, n, climp);
+	for(k = (L == NULL ? 0 : L->size) - 1; k >= 0; k --){
+		j = L->fp[k];
+		if(FP[j].len < n || (mineMode == MINE_CLOSED && FP[j].climp != climp)){
+			continue;
+		}
+#if ITEM_MASK
+		if((mask & ~FP[j].mask) == 0){
+#else
+		if(sub_items(S, n, FP_ITEMS(&FP[j]), FP[j].len) == true){
+#endif
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+  Drop the patterns subsumed by another stored one. The checks during
+  FPgrowth only see patterns found earlier; spilled and pseudo-projected
+  bases change that order, so this pass makes the result exact.
+*/
+void filterFP(void){
+
+	FPList *L;
+	int i, j, k, n;
+	long len;
+	char *drop;
+
+	if(mineMode == MINE_ALL || sizeFP == 0){
+		return;
+	}
+	drop = (char *)calloc(sizeFP, sizeof(char));
+	if(drop == NULL){
+		fprintf(stderr, "ERROR[filterFP]\n");
+		exit(0);
+	}
+	for(i = 0; i < sizeFP; i ++){
+		L = supersetsFP(FP_ITEMS(&FP[i]), FP[i].len, FP[i].climp);
+		for(k = 0; L != NULL && k < L->size && drop[i] == 0; k ++){
+			j = L->fp[k];
+			if(j == i || FP[j].len < FP[i].len || (mineMode == MINE_CLOSED && FP[j].climp != FP[i].climp)){
+				continue;
+			}
+			//of two equal itemsets keep the first
+			if(sub_itemset(&FP[i], &FP[j]) == true &&
+			   (j < i || sub_itemset(&FP[j], &FP[i]) == false)){
+				drop[i] = 1;
+			}
+		}
+	}
+	//the kept ones move down in place, offsets only grow with i
+	unindexFP();
+	n = 0;
+	len = 0;
+	for(i = 0; i < sizeFP; i ++){
+		if(drop[i] == 0){
+			memmove(fpItems + len, FP_ITEMS(&FP[i]), FP[i].len * sizeof(int));
+			FP[n] = FP[i];
+			FP[n].off = len;
+			indexFP(n ++);
+			len += FP[i].len;
+		}
+		else{
+			release_info(FP[i].info);
+		}
+	}
+	sizeFP = n;
+	fpLen = len;
+	free(drop);
+}
+
+void storeFP(int headItem, shortList *tail, weight_t count, TreeNode *head){
+
+  Itemset *I = newFP(headItem, tail, count);
+  TreeNode *node = head;
+  while(node != NULL && node->info != NULL){
+  	addFPInfo(I, node->info);
+  	node = node->nodeLink;
+  }
+}
+
+/* only the items of I are visited */
+weight_t get_dgimp(Itemset *I, Transaction *T){
+	
+	int i, *a = FP_ITEMS(I);
+	weight_t dgimp = 0;
+	for(i = 0; i < I->len; i ++){
+		dgimp += T->itemset[a[i]];
+	}
+	return dgimp;
+}
+
+boolean in_transaction(Itemset *I, Transaction *T){
+	
+#if ITEM_MASK
+	return (I->mask & ~T->mask) ? false : true;
+#else
+	int i, *a = FP_ITEMS(I);
+	for(i = 0; i < I->len; i ++){
+		if(T->itemset[a[i]] == 0){
+			return false;
+		}
+	}
+	return true;
+#endif
+}
+
+/* sorts by c, the item keys (item weights) move along */
+void sortList( shortList *oList, shortList *sList, Counter *c ){
+  int i;
+  longList Q;
+  weight_t key[MAXITEMS+1];
 
   Q.size = 0;
-  for( i=1; i <= oList->size; i++ )
-    insMinUQ( &Q, c->cnt[oList->datum1[i]], oList->datum1[i] );
-  heapSortDescUQ( &Q );
+  for( i=1; i <= oList->size; i++ ){
+    appendUQ( &Q, c->cnt[oList->datum1[i]], oList->datum1[i] );
+    key[oList->datum1[i]] = oList->key[i];
+  }
+  sortDescUQ( &Q );
 
   sList->size = oList->size;
-  for( i=1; i <= Q.size; i++ )
+  for( i=1; i <= Q.size; i++ ){
     sList->datum1[i] = Q.datum1[i];
+    sList->key[i] = key[Q.datum1[i]];
+  }
 }
 
 int countMem( int prevMemSpc, Header *hdr ){
@@ -767,7 +2124,7 @@ void showHdr( Header *H ){
 
   printf( "Header (len=%d):\n", H->hdrLen );
   for( i=1; i <= H->hdrLen; i++ )
-    printf( "\t[%d]\t%d %d %ld %ld lgwt: %d\n", i, H->item[i], H->nodeCnt[i], (intptr_t)(H->head[i]), (intptr_t)(H->tail[i]), H->lgwt[i] );
+    printf( "\t[%d]\t%d %d %ld %ld lgwt: %lld\n", i, H->item[i], H->nodeCnt[i], (intptr_t)(H->head[i]), (intptr_t)(H->tail[i]), (long long)H->lgwt[i] );
 }
 
 void showFullHdr( Header *H ){
@@ -803,7 +2160,7 @@ void showTree2helper(TreeNode *tree, int depth ){
   while( temp != NULL ){
     for( i=1; i <= depth; i++ )
       printf( "     " );
-    printf( "%d (%d)\n", temp->item, temp->count );
+    printf( "%d (%lld)\n", temp->item, (long long)temp->count );
     temp = temp->firstChild;
     showTree2helper( temp, depth+1 );
     while( temp != NULL ){
@@ -823,25 +2180,94 @@ void showTree( TreeNode *tree ){
   printf("\n");
   temp = tree;
   while( temp != NULL ){
-    printf( "tree: %d (%d)\n", temp->item, temp->count );
+    printf( "tree: %d (%lld)\n", temp->item, (long long)temp->count );
     temp = temp->firstChild;
   }
 
 }
 
-void insertTree( Header *H, shortList *list, PersonalInfo *P, int count, int ind, int indMax, TreeNode *tree ){
-
-  TreeNode *N;
-  int item, mappedItem;
-
-  if( list->size == 0 ){
-    return;
+/*
+  list->key[] holds the weight of each item in the inserted path and aw
+  the weight of the prefix; both are accounted at the last node.
+*/
+void accountPath( TreeNode *N, shortList *list, int first, int step, weight_t aw ){
+  weight_t *wv;
+  int j;
+
+  wv = nodeWeights( N );
+  N->aw += aw;
+  N->bound += aw;
+  for( j=1; j <= N->depth; j++ ){
+    wv[j-1] += list->key[first + (j-1)*step];
+    N->bound += list->key[first + (j-1)*step];
   }
-  item = list->datum1[ind];
-  mappedItem = H->mapHdr[item];
+}
 
-  if( tree->firstChild == NULL ){
-     // IF FIRST CHILD NULL
+/*
+  Pair counts (FP-array). For header positions q <= p, cell (p,q) sums
+  over the transactions of the tree that have both items: their count,
+  the bound the node of p gets from them and the weight of q in them.
+  Row p is thus the conditional c, b and w of item p, and FPgrowth
+  reads it instead of walking the paths of the base. The bound is
+  the prefix weight plus the weights of the items down to p, as
+  passInfoUp leaves it once the items below p are mined. Only
+  headers of at most PAIR_MAX_HDR items get a matrix, and with -m only
+  when growing it keeps memUsed within the budget; it is cleared once
+  the header is complete and filled as the paths are inserted.
+*/
+#define PAIR_CELL(p,q) (3 * ((long)(p) * ((p) - 1) / 2 + (q) - 1))
+
+void initPairs( Header *H ){
+  weight_t *pair;
+  long n;
+
+  H->pairs = FALSE;
+  if( ! PAIR_COUNTS || H->hdrLen > PAIR_MAX_HDR ) return;
+  n = PAIR_CELL( H->hdrLen + 1, 1 );
+  if( n > H->pairCap ){
+    if( memBudget > 0 && memUsed + (n - H->pairCap) * (long)sizeof(weight_t) > memBudget )
+      return;	// counted along the paths instead
+    pair = (weight_t *)realloc( H->pair, n * sizeof(weight_t) );
+    if( pair == NULL ) return;
+    memUsed += (n - H->pairCap) * (long)sizeof(weight_t);
+    H->pair = pair;
+    H->pairCap = n;
+  }
+  memset( H->pair, 0, n * sizeof(weight_t) );
+  H->pairs = TRUE;
+}
+
+/* adds the path of len items list->datum1[first], [first+step], ... */
+void countPairs( Header *H, shortList *list, int first, int step, int len, weight_t count, weight_t aw ){
+  weight_t *row, *cell, bound = aw;
+  int i, j;
+
+  for( j=0; j < len; j++ ){
+    bound += list->key[first + j*step];
+    row = &H->pair[PAIR_CELL( H->mapHdr[list->datum1[first + j*step]], 1 )];
+    for( i=0; i <= j; i++ ){
+      cell = &row[3 * (H->mapHdr[list->datum1[first + i*step]] - 1)];
+      cell[0] += count;
+      cell[1] += bound;
+      cell[2] += list->key[first + i*step];
+    }
+  }
+}
+
+void insertTree( Header *H, shortList *list, PersonalInfo *P, weight_t count, weight_t aw,
+		int ind, int indMax, TreeNode *tree ){
+
+  TreeNode *N;
+  int item, mappedItem;
+
+  if( list->size == 0 ){
+    return;
+  }
+  item = list->datum1[ind];
+  mappedItem = H->mapHdr[item];
+
+  if( tree->firstChild == NULL ){
+     // IF FIRST CHILD NULL
   	//printf("\nInsert item (%d) First child null", item);
     N = createNewNode( item, count );
     N->parent = tree;
@@ -887,13 +2313,19 @@ void insertTree( Header *H, shortList *list, PersonalInfo *P, int count, int ind
       (H->lgwt[mappedItem]) += count;
     }
   }
+  N->depth = tree->depth + 1;
+  if(ind == indMax){
+  	accountPath( N, list, ind - N->depth + 1, 1, aw );
+  	H->cells += N->depth;
+  	if( H->pairs ) countPairs( H, list, ind - N->depth + 1, 1, N->depth, count, aw );
+  }
   //if we are the last child in the list
   //add personal information
   if(ind == indMax && N->info == NULL && P != NULL){
-  	N->info = P;
+  	N->info = retain_info(P);
   }
   else if(ind == indMax && N->info != NULL && P != NULL){
-  	combine_info(P, N->info);
+  	N->info = combine_info(P, N->info);
   }
   
   if( DEBUG ){
@@ -901,11 +2333,11 @@ void insertTree( Header *H, shortList *list, PersonalInfo *P, int count, int ind
     showHdr( H );
   }
   if( ind < indMax ) // INSERT THE NEXT ITEM IN THE TRANSACTION
-    insertTree( H, list, P, count, ind+1, indMax, N );
+    insertTree( H, list, P, count, aw, ind+1, indMax, N );
 }
 
-void insertTreeRev( Header *H, shortList *list, PersonalInfo *P, int count, int ind,
-		   int indMin, TreeNode *tree ){
+void insertTreeRev( Header *H, shortList *list, PersonalInfo *P, weight_t count, weight_t aw,
+		   int ind, int indMin, TreeNode *tree ){
   TreeNode *N;
   int item, mappedItem;
 
@@ -948,18 +2380,24 @@ void insertTreeRev( Header *H, shortList *list, PersonalInfo *P, int count, int
       (H->lgwt[mappedItem]) += count;
     }
   }
+  N->depth = tree->depth + 1;
+  if(ind == indMin){
+  	accountPath( N, list, ind + N->depth - 1, -1, aw );
+  	H->cells += N->depth;
+  	if( H->pairs ) countPairs( H, list, ind + N->depth - 1, -1, N->depth, count, aw );
+  }
   if(ind == indMin && N->info == NULL && P != NULL){
-  	N->info = P;
+  	N->info = retain_info(P);
   }
   else if(ind == indMin && N->info != NULL && P != NULL){
-  	combine_info(P, N->info);
+  	N->info = combine_info(P, N->info);
   }
   if( DEBUG ){
     showTree( tree );
     showHdr( H );
   }
   if( ind > indMin )
-    insertTreeRev( H, list, P, count, ind-1, indMin, N );
+    insertTreeRev( H, list, P, count, aw, ind-1, indMin, N );
 }
 
 int isSinglePath( TreeNode *tree ){
@@ -987,298 +2425,2420 @@ void pathToListTD( TreeNode *tree, shortList *list ){
   }
 }
 
-/* choose(n,k) = n! / k! (n-k)! = prod_{i=k+1}^{n} i / (n-k)! */
-int choose( int n, int k ){
-  int i, prod;
-  int L, S;
+/* choose(n,k) = n! / k! (n-k)! = prod_{i=k+1}^{n} i / (n-k)! */
+int choose( int n, int k ){
+  int i, prod;
+  int L, S;
+
+  L = MAX(k, n-k);
+  S = MIN(k, n-k);
+
+  prod = 1;
+  for( i=n; i >= L+1; i-- )
+    prod *= i;
+  for( i=S; i >= 2; i-- )
+    prod /= i;
+  return prod;
+}
+
+/* mine( head | tail ) */
+void mine( shortList *head, shortList *tail ){
+  int j, k;
+  shortList head2;
+  shortList tail2;
+
+  if( head->size == 0 ){
+    fprintf( stderr, "ERROR[mine]: Infrequent (0H)\n" );
+    exit( -1 );
+  }
+
+  if( CNT_FP ){
+    for( k = 1; k <= head->size; k++ )
+      countL[MIN(k + tail->size,MAXLEVEL)] += choose(head->size,k);
+    return;
+  }
+
+  if( head->size == 1 ){
+    (countL[MIN(1 + tail->size,MAXLEVEL)])++;
+    //if( PRT_FP ){
+    //  if( head->key[1] >= minsup ){
+	//	showFP( head->datum1[1], tail, head->key[1] );
+    // }else{
+	//	fprintf( stderr, "ERROR[mine]: Infrequent (1H)\n" );
+	//	exit( -1 );
+    // }
+    //}
+  }else{
+    for( k = tail->size; k >= 1; k-- ){
+      tail2.datum1[k+1] = tail->datum1[k];
+      tail2.key[k+1] = tail->key[k];
+    }
+    tail2.size = tail->size + 1;
+
+    for( k = 1; k < head->size; k++ ){
+      head2.datum1[k] = head->datum1[k];
+      head2.key[k] = head->key[k];
+    }
+
+    for( j = head->size; j >= 1; j-- ){
+      #if CNT_FP
+	    (countL[MIN(tail2.size,MAXLEVEL)])++;
+	  #endif
+//      if( PRT_FP ){
+//		if( head->key[j] >= minsup ){
+//		  showFP( head->datum1[j], tail, head->key[1] );
+//		}else{
+//		  fprintf( stderr, "ERROR[mine]: Infrequent (mH)\n" );
+//		  exit( -1 );
+//		}
+//      }
+      if( j >= 2 ){
+	head2.size = j - 1;
+	tail2.datum1[1] = head->datum1[j];
+	tail2.key[1] = head->key[j];
+	mine( &head2, &tail2 );
+      }
+    }
+  }
+}
+
+/*
+  Adds the count, bound and item weights of the path at leaf to c, b
+  and w; returns the length of the path.
+*/
+int countFreq( TreeNode *leaf, Counter *c, Counter *b, Counter *w ){
+  TreeNode *X;
+  int len = 0;
+
+  X = leaf;
+  while( (X != NULL) && (X->item != ROOT) ){
+    c->cnt[X->item] += leaf->count;
+    b->cnt[X->item] += leaf->bound;
+    w->cnt[X->item] += leaf->wv[X->depth - 1];
+    X = X->parent;
+    len++;
+  }
+  return len;
+}
+
+/* keys get the weight of each item along the path (wv of its leaf) */
+void getRevList( Counter *c, TreeNode *N, shortList *list, weight_t minSig, weight_t *wv ){
+  TreeNode *X;
+
+  list->size = 0;
+  X = N;
+  while( X != NULL ){
+    if( (c->cnt[X->item] >= minSig) && (X->item != ROOT) ){
+      (list->size)++;
+      list->datum1[list->size] = X->item;
+      list->key[list->size] = wv[X->depth - 1];
+    }
+    X = X->parent;
+  }
+}
+
+/*
+  Prefix weight aw of the path from N up, with item weights wv, plus the
+  weights of the nNew items alpha2 puts in front of the old prefix.
+*/
+weight_t prefixWeight( TreeNode *N, weight_t *wv, weight_t aw, shortList *alpha2, int nNew ){
+  TreeNode *X;
+  int i;
+
+  for( X = N; X != NULL && X->item != ROOT; X = X->parent )
+    for( i=1; i <= nNew; i++ )
+      if( alpha2->datum1[i] == X->item )
+        aw += wv[X->depth - 1];
+  return aw;
+}
+
+/*
+  The conditional base of a header item inherits the info of its nodes,
+  and their weights and bound without the item itself.
+*/
+void passInfoUp( TreeNode *leaf ){
+  TreeNode *P = leaf->parent;
+  weight_t *wv;
+  int j;
+
+  if( growShared && frameDepth == 1 ) return;
+  if( leaf->wv != NULL ){
+    P->aw += leaf->aw;
+    P->bound += leaf->bound - leaf->wv[leaf->depth - 1];
+    if( P->item != ROOT ){
+      wv = nodeWeights( P );
+      for( j=0; j < P->depth; j++ )
+        wv[j] += leaf->wv[j];
+    }
+  }
+  if(leaf->info != NULL && leaf->parent->info == NULL){
+	leaf->parent->info = retain_info(leaf->info);
+  }
+  else if(leaf->parent->info != NULL && leaf->info != NULL){
+	leaf->parent->info = combine_info(leaf->info, leaf->parent->info);
+  }
+}
+
+void freeTree( TreeNode *tree, Header *hdr ){
+  int i;
+  TreeNode *head, *temp;
+
+  for( i=1; i <= hdr->hdrLen; i++ ){
+    head = hdr->head[i];
+    while( head != NULL ){
+      temp = head;
+      head = head->nodeLink;
+      release_info( temp->info );
+      releaseWeights( temp );
+      if( hdr->block == NULL ){
+        free( temp );
+        memUsed -= sizeof(TreeNode);
+      }
+    }
+  }
+  release_info( tree->info );
+  if( hdr->block != NULL ){	// compacted: the root heads the block
+    free( hdr->block );
+    memUsed -= hdr->blockLen * sizeof(TreeNode);
+    hdr->block = NULL;
+    hdr->blockLen = 0;
+  }else{
+    free( tree );
+    memUsed -= sizeof(TreeNode);
+  }
+}
+
+/*
+  Compaction (-c). The tree is copied into one block in DFS preorder, so
+  a node's path to the root and the first-child chains below it are
+  close together, and the nodeLink chains are rewritten to the copies in
+  the same order. While copying, the lastChild field of each old node
+  (not needed to walk the old tree) points to its copy.
+*/
+TreeNode *compactNodes( TreeNode *old, TreeNode *parent, TreeNode *blk, int *len ){
+  TreeNode *N = &blk[(*len)++], *C, *copy, *prev = NULL;
+
+  *N = *old;
+  N->parent = parent;
+  N->firstChild = NULL;
+  N->sibling = NULL;
+  N->nodeLink = NULL;
+  old->lastChild = N;
+  for( C = old->firstChild; C != NULL; C = C->sibling ){
+    copy = compactNodes( C, N, blk, len );
+    if( prev == NULL )
+      N->firstChild = copy;
+    else
+      prev->sibling = copy;
+    prev = copy;
+  }
+  N->lastChild = prev;
+  return N;
+}
+
+/* the compacted tree when it has at least minNodes nodes, else tree itself */
+TreeNode *compactTree( Header *H, TreeNode *tree, int minNodes ){
+  TreeNode *blk, *old, *next;
+  int h, n, len = 0;
+
+  for( h=1, n=1; h <= H->hdrLen; h++ )
+    n += H->nodeCnt[h];
+  if( n < minNodes || H->block != NULL ) return tree;
+  blk = (TreeNode *)malloc( n * sizeof(TreeNode) );
+  if( blk == NULL ) return tree;	// stays as it is
+  memUsed += n * sizeof(TreeNode);
+  compactNodes( tree, NULL, blk, &len );
+
+  for( h=1; h <= H->hdrLen; h++ ){
+    if( H->head[h] == NULL ) continue;
+    old = H->head[h];
+    H->head[h] = old->lastChild;
+    H->tail[h] = H->tail[h]->lastChild;
+    for( ; old != NULL; old = next ){
+      next = old->nodeLink;
+      old->lastChild->nodeLink = (next == NULL ? NULL : next->lastChild);
+      free( old );
+      memUsed -= sizeof(TreeNode);
+    }
+  }
+  free( tree );
+  memUsed -= sizeof(TreeNode);
+  H->block = blk;
+  H->blockLen = n;
+  return blk;
+}
+
+/* ======================================================================= */
+
+/*
+  Disk spilling of conditional pattern bases.
+
+  Partitions are appended to a temp file, unlinked on creation so it
+  disappears on exit. Two files take turns: while mineSpilled reads the
+  partitions of one, the ones it spills go to the other, and a file is
+  truncated as soon as its last partition is mined, so the disk holds
+  at most two generations of partitions. Partition layout: hdrLen,
+  header items (in LH order); then one record per path: count, prefix
+  weight, info flag, [info], path length, items in insertion order,
+  their weights.
+*/
+
+FILE *spillFile( void ){
+  char path[4096];
+  const char *dir;
+  int fd;
+  FILE *fp;
+
+  dir = getenv( "TMPDIR" );
+  if( dir == NULL || *dir == '\0' ) dir = "/tmp";
+  snprintf( path, sizeof(path), "%s/sftree-spill-XXXXXX", dir );
+  fd = mkstemp( path );
+  if( fd < 0 || (fp = fdopen( fd, "w+b" )) == NULL ){
+    fprintf( stderr, "ERROR[spillFile]: Can't create %s\n", path );
+    exit( 0 );
+  }
+  unlink( path );
+  return fp;
+}
+
+void spillWrite( FILE *fp, const void *buf, size_t size ){
+  if( fwrite( buf, size, 1, fp ) != 1 ){
+    fprintf( stderr, "ERROR[spillWrite]: Write failed\n" );
+    exit( 0 );
+  }
+  spillBytes += size;
+}
+
+/* info as: size, dense flag, then its indices or its bitmap */
+void spillInfo( FILE *fp, PersonalInfo *P ){
+  int dense = (P->words != NULL);
+
+  spillWrite( fp, &P->size, sizeof(int) );
+  spillWrite( fp, &dense, sizeof(int) );
+  if( dense )
+    spillWrite( fp, P->words, INFO_WORDS * sizeof(uint64_t) );
+  else if( P->size > 0 )
+    spillWrite( fp, P->tids, P->size * sizeof(int) );
+}
+
+/* write the conditional pattern base of the header-item chain at leaf */
+void spillBase( Header *LH, TreeNode *leaf, Counter *c, shortList *alpha, int nNew, weight_t minSig ){
+  SpillPart *S;
+  shortList list, RList;
+  weight_t aw;
+  int i, hasInfo;
+
+  S = (SpillPart *)malloc( sizeof(SpillPart) );
+  if( S == NULL ){
+    fprintf( stderr, "ERROR[spillBase]\n" );
+    exit( 0 );
+  }
+  if( spillFp == NULL )
+    spillFp = spillFile();
+  fseek( spillFp, 0, SEEK_END );
+  S->fp = spillFp;
+  S->offset = ftell( spillFp );
+  S->alpha = *alpha;
+  S->next = NULL;
+
+  spillWrite( spillFp, &LH->hdrLen, sizeof(int) );
+  spillWrite( spillFp, &LH->item[1], LH->hdrLen * sizeof(int) );
+  while( leaf != NULL ){
+    passInfoUp( leaf );
+    getRevList( c, leaf->parent, &list, minSig, leaf->wv );
+    if( list.size > 0 ){
+      if( sortTree ){
+        sortList( &list, &RList, c );
+      }else{
+        RList.size = list.size;
+        for( i=1; i <= list.size; i++ ){
+          RList.datum1[i] = list.datum1[list.size + 1 - i];
+          RList.key[i] = list.key[list.size + 1 - i];
+        }
+      }
+      aw = prefixWeight( leaf, leaf->wv, leaf->aw, alpha, nNew );
+      hasInfo = (leaf->info != NULL);
+      spillWrite( spillFp, &leaf->count, sizeof(weight_t) );
+      spillWrite( spillFp, &aw, sizeof(weight_t) );
+      spillWrite( spillFp, &hasInfo, sizeof(int) );
+      if( hasInfo )
+        spillInfo( spillFp, leaf->info );
+      spillWrite( spillFp, &RList.size, sizeof(int) );
+      spillWrite( spillFp, &RList.datum1[1], RList.size * sizeof(int) );
+      spillWrite( spillFp, &RList.key[1], RList.size * sizeof(weight_t) );
+    }
+    leaf = leaf->nodeLink;
+  }
+  S->end = ftell( spillFp );
+
+  if( spillTail == NULL )
+    spillHead = S;
+  else
+    spillTail->next = S;
+  spillTail = S;
+  numSpilled++;
+}
+
+int spillRead( FILE *fp, void *buf, size_t size ){
+  return (fread( buf, size, 1, fp ) == 1);
+}
+
+PersonalInfo *readInfo( FILE *fp ){
+  PersonalInfo *P = new_info();
+  int dense;
+
+  if( ! spillRead( fp, &P->size, sizeof(int) ) || ! spillRead( fp, &dense, sizeof(int) ) ){
+    fprintf( stderr, "ERROR[readInfo]: Truncated partition\n" );
+    exit( 0 );
+  }
+  if( dense ){
+    info_alloc_words( P );
+    if( ! spillRead( fp, P->words, INFO_WORDS * sizeof(uint64_t) ) ){
+      fprintf( stderr, "ERROR[readInfo]\n" );
+      exit( 0 );
+    }
+  }else if( P->size > 0 ){
+    info_reserve( P, P->size );
+    if( ! spillRead( fp, P->tids, P->size * sizeof(int) ) ){
+      fprintf( stderr, "ERROR[readInfo]: Truncated partition\n" );
+      exit( 0 );
+    }
+  }
+  return P;
+}
+
+void FPgrowth( Header *H, TreeNode *tree, shortList *alpha, int memSpc, weight_t minSig);
+
+/* mine the spilled partitions in FIFO order; mining may append more */
+void mineSpilled( weight_t minSig ){
+  SpillPart *S;
+  Header LH;
+  TreeNode *bTree;
+  shortList list;
+  PersonalInfo *P;
+  FILE *in;
+  weight_t count, aw;
+  int i, n, hasInfo;
+
+  initHdr( &LH );
+  while( spillHead != NULL ){
+    S = spillHead;
+    if( S->fp == spillFp ){	// a new generation: spill to the other file
+      if( spillSpare == NULL )
+        spillSpare = spillFile();
+      spillFp = spillSpare;
+      spillSpare = S->fp;
+    }
+    in = S->fp;
+    fseek( in, S->offset, SEEK_SET );
+
+    cleanHdr( &LH );
+    if( ! spillRead( in, &n, sizeof(int) ) ) n = 0;
+    for( i=1; i <= n; i++ ){
+      if( ! spillRead( in, &list.datum1[i], sizeof(int) ) ){
+        fprintf( stderr, "ERROR[mineSpilled]: Truncated partition\n" );
+        exit( 0 );
+      }
+      insertHdr( &LH, list.datum1[i], 0 );
+    }
+    initPairs( &LH );
+
+    bTree = createNewNode( ROOT, 1 );
+    while( ftell( in ) < S->end ){
+      P = NULL;
+      if( ! spillRead( in, &count, sizeof(weight_t) ) ||
+          ! spillRead( in, &aw, sizeof(weight_t) ) ||
+          ! spillRead( in, &hasInfo, sizeof(int) ) ){
+        fprintf( stderr, "ERROR[mineSpilled]: Truncated partition\n" );
+        exit( 0 );
+      }
+      if( hasInfo )
+        P = readInfo( in );
+      if( ! spillRead( in, &list.size, sizeof(int) ) ||
+          (list.size > 0 && (fread( &list.datum1[1], sizeof(int), list.size, in ) != (size_t)list.size ||
+                             fread( &list.key[1], sizeof(weight_t), list.size, in ) != (size_t)list.size)) ){
+        fprintf( stderr, "ERROR[mineSpilled]: Truncated partition\n" );
+        exit( 0 );
+      }
+      insertTree( &LH, &list, P, count, aw, 1, list.size, bTree );
+      release_info( P );
+    }
+
+    if( compactTrees )
+      bTree = compactTree( &LH, bTree, COMPACT_NODES );
+    FPgrowth( &LH, bTree, &S->alpha, countMem(0,&LH), minSig );
+    freeTree( bTree, &LH );
+
+    spillHead = S->next;
+    if( spillHead == NULL ) spillTail = NULL;
+    if( spillHead == NULL || spillHead->fp != in ){	// its last partition
+      fflush( in );
+      if( ftruncate( fileno( in ), 0 ) != 0 ){
+        fprintf( stderr, "ERROR[mineSpilled]: Can't truncate the spill file\n" );
+        exit( 0 );
+      }
+      rewind( in );
+    }
+    free( S );
+  }
+  freePairs( &LH );
+  if( spillFp != NULL )
+    fclose( spillFp );
+  if( spillSpare != NULL )
+    fclose( spillSpare );
+  spillFp = spillSpare = NULL;
+}
+
+/* ======================================================================= */
+
+GrowFrame *enterFrame( void ){
+  GrowFrame **pool;
+  int i, len;
+
+  if( frameDepth >= framePoolLen ){
+    len = (framePoolLen == 0 ? 16 : 2 * framePoolLen);
+    pool = (GrowFrame **)realloc( framePool, len * sizeof(GrowFrame *) );
+    if( pool == NULL ){
+      fprintf( stderr, "ERROR[enterFrame]\n" );
+      exit( 0 );
+    }
+    for( i = framePoolLen; i < len; i++ )
+      pool[i] = NULL;
+    framePool = pool;
+    framePoolLen = len;
+  }
+  if( framePool[frameDepth] == NULL ){
+    framePool[frameDepth] = (GrowFrame *)calloc( 1, sizeof(GrowFrame) );
+    if( framePool[frameDepth] == NULL ){
+      fprintf( stderr, "ERROR[enterFrame]\n" );
+      exit( 0 );
+    }
+    initHdr( &framePool[frameDepth]->LH );
+  }
+  return framePool[frameDepth++];
+}
+
+void leaveFrame( void ){
+  frameDepth--;
+}
+
+void freeFrames( void ){
+  int i;
+
+  for( i=0; i < framePoolLen; i++ )
+    if( framePool[i] != NULL ){
+      freePairs( &framePool[i]->LH );
+      free( framePool[i] );
+    }
+  free( framePool );
+  framePool = NULL;
+  framePoolLen = 0;
+}
+
+/* ======================================================================= */
+
+/*
+  Prefix step shared by FPgrowth and pseudoGrowth for x = H->item[h]
+  with conditional counts c. Fills alpha2 with the prefix the projection
+  of x is conditioned on and stores the pattern, returned through *I
+  (NULL when nothing is stored). Returns FALSE when the whole branch is
+  pruned.
+
+  Closed: items counted as often as x occur in every transaction with x;
+  they are merged into the prefix and zeroed in c so the projection
+  skips them. A prefix covered by a stored pattern of the same count
+  cannot lead to new closed patterns.
+  Maximal: maximality is decided among the significant patterns only
+  (exact dgimp >= minSig), so only those are stored and a stored pattern
+  is always a verified one. A prefix covered by a stored pattern is not
+  stored, and a branch whose prefix plus all extensions is covered is
+  skipped; filterFP drops the subsets of patterns stored later.
+
+  b holds the bounds on dgimp: b[x] bounds every pattern of the branch,
+  b[y] every pattern that extends the prefix with y. Branches and
+  extensions failing their bound hold no significant pattern and are cut.
+
+  The exact dgimp of the pattern is aw, the weight of the old prefix in
+  the transactions with x, plus w of x and of the merged closure items.
+*/
+int growPrefix( Header *H, int h, Counter *c, Counter *b, Counter *w, weight_t aw,
+		shortList *alpha, shortList *alpha2, weight_t minSig, Itemset **I ){
+  int i, x, ext = FALSE, nS = 0;
+  int S[MAXITEMS+1];
+  weight_t cx, dg;
+  shortList tail;
+
+  x = H->item[h];
+  cx = c->cnt[x];
+  dg = aw + w->cnt[x];
+  *I = NULL;
+  if( b->cnt[x] < minSig ) return FALSE;
+
+  alpha2->size = 1;
+  alpha2->datum1[1] = x;
+  alpha2->key[1] = cx;
+  if( mineMode == MINE_CLOSED && cx >= minSig ){
+    for( i=1; i < h; i++ )
+      if( c->cnt[H->item[i]] == cx ){
+        (alpha2->size)++;
+        alpha2->datum1[alpha2->size] = H->item[i];
+        alpha2->key[alpha2->size] = cx;
+        dg += w->cnt[H->item[i]];
+        c->cnt[H->item[i]] = 0;
+      }
+  }
+  tail.size = 0;
+  for( i=2; i <= alpha2->size; i++ ){
+    (tail.size)++;
+    tail.datum1[tail.size] = alpha2->datum1[i];
+    tail.key[tail.size] = alpha2->key[i];
+  }
+  for( i=1; i <= alpha->size; i++ ){
+    (alpha2->size)++;
+    alpha2->datum1[alpha2->size] = alpha->datum1[i];
+    alpha2->key[alpha2->size] = alpha->key[i];
+    (tail.size)++;
+    tail.datum1[tail.size] = alpha->datum1[i];
+    tail.key[tail.size] = alpha->key[i];
+  }
+
+  if( cx < minSig ) return TRUE;
+
+  if( mineMode != MINE_ALL ){
+    for( i=1; i <= alpha2->size; i++ )
+      S[nS++] = alpha2->datum1[i];
+  }
+  if( mineMode == MINE_CLOSED ){
+    if( subsumedFP( S, nS, cx ) == true ) return FALSE;
+  }else if( mineMode == MINE_MAXIMAL ){
+    for( i=1; i < h; i++ )
+      if( c->cnt[H->item[i]] >= minSig ){
+        S[nS++] = H->item[i];
+        ext = TRUE;
+      }
+    if( subsumedFP( S, nS, cx ) == true ) return FALSE;
+  }
+  for( i=1; i < h; i++ )
+    if( b->cnt[H->item[i]] < minSig )
+      c->cnt[H->item[i]] = 0;
+  if( mineMode == MINE_MAXIMAL ){
+    if( dg < minSig ) return TRUE;
+    if( ext ){
+      for( i=1; i <= alpha2->size; i++ )
+        S[i-1] = alpha2->datum1[i];
+      if( subsumedFP( S, alpha2->size, cx ) == true ) return TRUE;
+    }
+  }
+
+  if( PRT_FP ){
+    if( echoCandidates ) showFP( x, &tail, cx, H->head[h] );
+    *I = newFP( x, &tail, cx );
+    (*I)->dgimp = dg;
+    if(PRT_FALSE_POS){
+      initial_number ++;
+    }
+  }
+  return TRUE;
+}
+
+/* ======================================================================= */
+
+/*
+  Pseudo-projection. A small conditional base is mined in place: each
+  path is a reference (start node, count, weights, info) into the parent tree and
+  the items of a level are the ones ranked in its header, so no tree is
+  copied. Ranks only shrink with depth, so the current header alone
+  decides which path items are visible.
+*/
+
+void pseudoGrowth( Header *LH, PathRef *refs, int nRefs, shortList *alpha, weight_t minSig ){
+  int k, i, r, m, x, rank;
+  GrowFrame *F = enterFrame();
+  Counter *c = &F->c, *b = &F->b, *w = &F->w;
+  weight_t aw;
+  Header *LH2 = &F->LH;
+  longList *Q = &F->Q;
+  shortList *alpha2 = &F->alpha2;
+  PathRef *sub;
+  TreeNode *X;
+  Itemset *I;
+
+  sub = (PathRef *)malloc( (nRefs + 1) * sizeof(PathRef) );
+  if( sub == NULL ){
+    fprintf( stderr, "ERROR[pseudoGrowth]\n" );
+    exit( 0 );
+  }
+  for( k = LH->hdrLen; k >= 1; k-- ){
+    x = LH->item[k];
+    for( i=1; i <= k; i++ ){
+      c->cnt[LH->item[i]] = 0;
+      b->cnt[LH->item[i]] = 0;
+      w->cnt[LH->item[i]] = 0;
+    }
+
+    m = 0;
+    aw = 0;
+    for( r=0; r < nRefs; r++ ){
+      X = refs[r].node;
+      while( X != NULL && X->item != ROOT && X->item != x )
+        X = X->parent;
+      if( X == NULL || X->item != x ) continue;
+      sub[m++] = refs[r];
+      aw += refs[r].aw;
+      for( X = refs[r].node; X != NULL && X->item != ROOT; X = X->parent ){
+        rank = LH->mapHdr[X->item];
+        if( rank > 0 && rank <= k ){
+          c->cnt[X->item] += refs[r].count;
+          b->cnt[X->item] += refs[r].bound;
+          w->cnt[X->item] += refs[r].wv[X->depth - 1];
+        }
+      }
+    }
+
+    #if CNT_FP
+    (countL[MIN(1 + alpha->size,MAXLEVEL)])++;
+    #endif
+    if( ! growPrefix( LH, k, c, b, w, aw, alpha, alpha2, minSig, &I ) ) continue;
+    if( I != NULL )
+      for( r=0; r < m; r++ )
+        addFPInfo( I, sub[r].info );
+    for( r=0; r < m; r++ )
+      sub[r].aw = prefixWeight( sub[r].node, sub[r].wv, sub[r].aw, alpha2, alpha2->size - alpha->size );
+
+    Q->size = 0;
+    for( i=1; i < k; i++ )
+      if( c->cnt[LH->item[i]] >= minSig )
+        appendUQ( Q, c->cnt[LH->item[i]], LH->item[i] );
+    if( Q->size == 0 ) continue;
+    sortDescUQ( Q );
+    cleanHdr( LH2 );
+    for( i=1; i <= Q->size; i++ )
+      insertHdr( LH2, Q->datum1[i], 0 );
+
+    pseudoGrowth( LH2, sub, m, alpha2, minSig );
+  }
+  free( sub );
+  leaveFrame();
+}
+
+/* ======================================================================= */
+
+/*
+  Vertical engine (-E vertical). Every header position is a bitmap over
+  the rows, the filtered (and merged) transactions, and a pattern is
+  grown by ANDing the bitmap of its prefix with the one of each item
+  ranked above its last item, as FPgrowth extends a header item with
+  the items above it. Summing over the rows of the result gives climp
+  (count), dgimp (prefix weight pw plus the item's weight) and the bound
+  on the branch (pw plus the weights of all positions down to the item),
+  so the same candidates are cut. The word loops are plain so the
+  compiler vectorizes them. Closed and maximal patterns are stored after
+  their extensions are known: not when an extension has the same climp,
+  only when none is frequent; filterFP then checks the other supersets.
+*/
+
+void initVertical( Vertical *V ){
+  memset( V, 0, sizeof(Vertical) );
+}
+
+/* stages a row with the items of list (mapped to H) and prefix weight aw */
+void addRow( Vertical *V, Header *H, shortList *list, weight_t count, weight_t aw, PersonalInfo *P ){
+  int i;
+
+  if( V->nRows + 1 >= V->cap ){
+    V->cap = (V->cap == 0 ? 1024 : 2 * V->cap);
+    V->count = (weight_t *)realloc( V->count, V->cap * sizeof(weight_t) );
+    V->pw = (weight_t *)realloc( V->pw, V->cap * sizeof(weight_t) );
+    V->info = (PersonalInfo **)realloc( V->info, V->cap * sizeof(PersonalInfo *) );
+    V->start = (int *)realloc( V->start, (V->cap + 1) * sizeof(int) );
+    if( V->count == NULL || V->pw == NULL || V->info == NULL || V->start == NULL ){
+      fprintf( stderr, "ERROR[addRow]\n" );
+      exit( 0 );
+    }
+  }
+  if( V->itemLen + list->size > V->itemCap ){
+    V->itemCap = 2 * (V->itemLen + list->size) + 1024;
+    V->item = (int *)realloc( V->item, V->itemCap * sizeof(int) );
+    V->key = (weight_t *)realloc( V->key, V->itemCap * sizeof(weight_t) );
+    if( V->item == NULL || V->key == NULL ){
+      fprintf( stderr, "ERROR[addRow]\n" );
+      exit( 0 );
+    }
+  }
+  V->start[V->nRows] = V->itemLen;
+  for( i=1; i <= list->size; i++ )
+    if( H->mapHdr[list->datum1[i]] > 0 ){
+      V->item[V->itemLen] = H->mapHdr[list->datum1[i]];
+      V->key[V->itemLen] = list->key[i];
+      V->itemLen++;
+    }
+  V->count[V->nRows] = count;
+  V->pw[V->nRows] = aw;
+  V->info[V->nRows] = retain_info( P );
+  V->nRows++;
+  V->start[V->nRows] = V->itemLen;
+}
+
+/* turns the staged rows into bitmaps and cumulative weights over hdrLen positions */
+void buildVertical( Vertical *V, int hdrLen ){
+  PersonalInfo *P;
+  weight_t *cum;
+  int r, j, k;
+
+  V->hdrLen = hdrLen;
+  V->words = (V->nRows >> 6) + 1;
+  V->bits = (uint64_t *)calloc( (long)hdrLen * V->words, sizeof(uint64_t) );
+  V->cum = (weight_t *)calloc( (long)(hdrLen + 1) * V->nRows + 1, sizeof(weight_t) );
+  V->scratch = (uint64_t *)malloc( (long)(MAXLISTITEMS + 2) * V->words * sizeof(uint64_t) );
+  V->mark = (uint64_t *)calloc( INFO_WORDS, sizeof(uint64_t) );
+  V->tid = (int *)malloc( (V->nRows + 1) * sizeof(int) );
+  if( V->bits == NULL || V->cum == NULL || V->scratch == NULL || V->mark == NULL || V->tid == NULL ){
+    fprintf( stderr, "ERROR[buildVertical]: No memory for %d rows of %d items\n", V->nRows, hdrLen );
+    exit( 0 );
+  }
+  for( r=0; r < V->nRows; r++ ){
+    P = V->info[r];
+    V->tid[r] = (P != NULL && P->words == NULL && P->size == 1) ? P->tids[0] : 0;
+  }
+  for( r=0; r < V->nRows; r++ )
+    for( j = V->start[r]; j < V->start[r+1]; j++ ){
+      k = V->item[j];
+      V->bits[(long)(k - 1) * V->words + (r >> 6)] |= (uint64_t)1 << (r & 63);
+      V->cum[(long)k * V->nRows + r] += V->key[j];
+    }
+  for( k=1; k <= hdrLen; k++ ){
+    cum = V->cum + (long)k * V->nRows;
+    for( r=0; r < V->nRows; r++ )
+      cum[r] += cum[r - V->nRows];
+  }
+  free( V->item );
+  free( V->key );
+  free( V->start );
+  V->item = NULL;
+  V->key = NULL;
+  V->start = NULL;
+  V->itemLen = V->itemCap = 0;
+}
+
+void freeVertical( Vertical *V ){
+  int r;
+
+  for( r=0; r < V->nRows; r++ )
+    release_info( V->info[r] );
+  free( V->count );
+  free( V->pw );
+  free( V->info );
+  free( V->tid );
+  free( V->start );
+  free( V->item );
+  free( V->key );
+  free( V->bits );
+  free( V->cum );
+  free( V->scratch );
+  free( V->mark );
+  initVertical( V );
+}
+
+/* stores item k with prefix alpha over the rows in sub[lo..hi) */
+void vertStore( Vertical *V, Header *H, int k, uint64_t *sub, int lo, int hi,
+		shortList *alpha, weight_t cnt, weight_t dg ){
+  Itemset *I;
+  uint64_t x;
+  int wd, r, t;
+
+  if( echoCandidates ) showFP( H->item[k], alpha, cnt, NULL );
+  I = newFP( H->item[k], alpha, cnt );
+  I->dgimp = dg;
+  for( wd = lo; wd < hi; wd++ )
+    for( x = sub[wd]; x != 0; x &= x - 1 ){
+      r = (wd << 6) + __builtin_ctzll( x );
+      if( (t = V->tid[r]) > 0 )
+        V->mark[t >> 6] |= (uint64_t)1 << (t & 63);
+      else if( V->info[r] != NULL )
+        info_mark( V->info[r], V->mark );
+    }
+  I->info = info_from_words( V->mark );
+  if( PRT_FALSE_POS ){
+    initial_number ++;
+  }
+}
+
+/* TRUE if a stored pattern covers item k with prefix alpha (maximal mode) */
+boolean vertCovered( Header *H, int k, shortList *alpha ){
+  int i, S[MAXLISTITEMS+1];
+
+  S[0] = H->item[k];
+  for( i=1; i <= alpha->size; i++ )
+    S[i] = alpha->datum1[i];
+  return subsumedFP( S, alpha->size + 1, 0 );
+}
+
+/*
+  Grows the pattern alpha, with rows tids (nonzero in words lo..hi), by
+  the positions above m. Returns the largest climp of a frequent
+  extension, -1 when there is none.
+*/
+weight_t vertGrowth( Vertical *V, Header *H, uint64_t *tids, int lo, int hi, int m,
+		     shortList *alpha, weight_t minSig ){
+  uint64_t *sub = V->scratch + (long)(alpha->size + 1) * V->words, *bits, x;
+  weight_t *cum, *prev, cnt, dg, bnd, ext, best = -1;
+  int k, wd, r, sLo, sHi;
+
+  for( k = m - 1; k >= 1; k-- ){
+    bits = V->bits + (long)(k - 1) * V->words;
+    for( wd = lo; wd < hi; wd++ )
+      sub[wd] = tids[wd] & bits[wd];
+
+    cum = V->cum + (long)k * V->nRows;
+    prev = cum - V->nRows;
+    cnt = dg = bnd = 0;
+    sLo = hi;
+    sHi = lo;
+    for( wd = lo; wd < hi; wd++ ){
+      if( sub[wd] == 0 ) continue;
+      if( sLo == hi ) sLo = wd;
+      sHi = wd + 1;
+      for( x = sub[wd]; x != 0; x &= x - 1 ){
+        r = (wd << 6) + __builtin_ctzll( x );
+        cnt += V->count[r];
+        dg += V->pw[r] + cum[r] - prev[r];
+        bnd += V->pw[r] + cum[r];
+      }
+    }
+    #if CNT_FP
+    (countL[MIN(1 + alpha->size,MAXLEVEL)])++;
+    #endif
+    if( cnt < minSig ) continue;
+    if( cnt > best ) best = cnt;
+    if( bnd < minSig ) continue;
+
+    if( PRT_FP && mineMode == MINE_ALL )
+      vertStore( V, H, k, sub, sLo, sHi, alpha, cnt, dg );
+    if( k == 1 || alpha->size >= MAXLISTITEMS ){
+      ext = -1;
+    }else{
+      for( wd = sLo; wd < sHi; wd++ )
+        for( x = sub[wd]; x != 0; x &= x - 1 ){
+          r = (wd << 6) + __builtin_ctzll( x );
+          V->pw[r] += cum[r] - prev[r];
+        }
+      (alpha->size)++;
+      alpha->datum1[alpha->size] = H->item[k];
+      alpha->key[alpha->size] = cnt;
+      ext = vertGrowth( V, H, sub, sLo, sHi, k, alpha, minSig );
+      (alpha->size)--;
+      for( wd = sLo; wd < sHi; wd++ )
+        for( x = sub[wd]; x != 0; x &= x - 1 ){
+          r = (wd << 6) + __builtin_ctzll( x );
+          V->pw[r] -= cum[r] - prev[r];
+        }
+    }
+    if( PRT_FP && ((mineMode == MINE_CLOSED && ext != cnt) ||
+                   (mineMode == MINE_MAXIMAL && dg >= minSig &&
+                    vertCovered( H, k, alpha ) == false)) )
+      vertStore( V, H, k, sub, sLo, sHi, alpha, cnt, dg );
+  }
+  return best;
+}
+
+/* mines every extension of alpha in the rows of V, whose positions are those of H */
+void vertMine( Vertical *V, Header *H, shortList *alpha, weight_t minSig ){
+  uint64_t *all = V->scratch;
+  int wd;
+
+  for( wd = 0; wd < V->words; wd++ )
+    all[wd] = ~(uint64_t)0;
+  all[V->words - 1] = ((uint64_t)1 << (V->nRows & 63)) - 1;
+  vertGrowth( V, H, all, 0, V->words, V->hdrLen + 1, alpha, minSig );
+}
+
+/* items of LH on the paths above the header-item chain at leaf */
+long baseCells( Header *LH, TreeNode *leaf ){
+  TreeNode *X;
+  long n = 0;
+
+  for( ; leaf != NULL; leaf = leaf->nodeLink )
+    for( X = leaf->parent; X != NULL && X->item != ROOT; X = X->parent )
+      n += (LH->mapHdr[X->item] > 0);
+  return n;
+}
+
+/*
+  Hybrid engine (-E hybrid): the conditional base of the header-item
+  chain at leaf, with the projected header LH, mined as bitmaps instead
+  of a projected tree. Each path is a row, weighted as insertTree would
+  account it.
+*/
+void vertBase( Header *LH, TreeNode *leaf, Counter *c, shortList *alpha, int nNew, weight_t minSig ){
+  Vertical V;
+  shortList list;
+
+  initVertical( &V );
+  for( ; leaf != NULL; leaf = leaf->nodeLink ){
+    passInfoUp( leaf );
+    getRevList( c, leaf->parent, &list, minSig, leaf->wv );
+    if( list.size > 0 )
+      addRow( &V, LH, &list, leaf->count,
+	      prefixWeight( leaf, leaf->wv, leaf->aw, alpha, nNew ), leaf->info );
+  }
+  if( V.nRows > 0 ){
+    buildVertical( &V, LH->hdrLen );
+    vertMine( &V, LH, alpha, minSig );
+  }
+  freeVertical( &V );
+}
+
+/* ======================================================================= */
+
+/*
+  FPgrowth phases by depth. Only the top levels are timed; a deeper call
+  counts in the phase of its ancestor, so the recursion itself pays no
+  timer cost.
+*/
+static const char *growPhase[] = { "FPgrowth depth 1", "FPgrowth depth 2", "FPgrowth depth 3" };
+#define GROW_PHASES	((int)(sizeof(growPhase) / sizeof(growPhase[0])))
+
+void FPgrowth( Header *H, TreeNode *tree, shortList *alpha, int memSpc, weight_t minSig){
+  int h, i, baseNodes, nRefs, nNew;
+  long treeNodes = 0;
+  PathRef *refs;
+  Itemset *I;
+  GrowFrame *F;
+  Counter *c, *b, *w;
+  weight_t aw, *row;
+  TreeNode *leaf;
+  shortList *list, *RList;
+  Header *LH;
+  TreeNode *bTree;
+  shortList *alpha2;
+  longList *Q;
+  int timed = frameDepth < GROW_PHASES;
+
+  if( timed ) phaseBegin( growPhase[frameDepth] );
+  F = enterFrame();
+  c = &F->c; b = &F->b; w = &F->w;
+  list = &F->list; RList = &F->RList;
+  LH = &F->LH;
+  alpha2 = &F->alpha2;
+  Q = &F->Q;
+
+  if( SING_PATH && (frameDepth > 1 || (growFloor == 1 && growOnly == NULL)) && isSinglePath(tree) ){
+    /* SINGLE-PATH TREE: extract items into a list in top-down fashion */
+    if( DEBUG ) printf( "single path\n" );
+    pathToListTD( tree, list );		// COPY THE PATH TO THE LIST
+    if( DEBUG ) showSList( list );
+    mine( list, alpha );				// MINE THE ITEMS IN THE LIST
+  }else{
+	  // IF NOT SINGLE PATH TREE I.E. MULTI-PART TREE
+    if( DEBUG ) printf( "multi path\n" );
+    // printf("[%d]", H->hdrLen);
+    for( h=1; h <= H->hdrLen; h++ )
+      treeNodes += H->nodeCnt[h];
+    for( h = H->hdrLen; h >= (frameDepth == 1 ? growFloor : 1); h-- ){
+	      if( DEBUG ) printf( "multi path: %d\n", H->item[h] );
+	      /* NOTE: H->head[h]->item == H->item[h] */
+
+	      // the weights of the item below are all passed up by now
+	      if( h < H->hdrLen && ! (growShared && frameDepth == 1) )
+			for( leaf = H->head[h+1]; leaf != NULL; leaf = leaf->nodeLink )
+			  releaseWeights( leaf );
+
+	      if( frameDepth == 1 && growOnly != NULL && ! growOnly[h] ){
+			for( leaf = H->head[h]; leaf != NULL; leaf = leaf->nodeLink )
+			  passInfoUp( leaf );
+			continue;
+	      }
+
+	      leaf = H->head[h];
+	      baseNodes = 0;
+	      aw = 0;
+	      if( H->pairs ){	// the counts are row h of the pair matrix
+			row = &H->pair[PAIR_CELL( h, 1 )];
+			for( i=1; i <= h; i++, row += 3 ){
+			  c->cnt[H->item[i]] = row[0];
+			  b->cnt[H->item[i]] = row[1];
+			  w->cnt[H->item[i]] = row[2];
+			}
+			for( ; leaf != NULL; leaf = leaf->nodeLink ){
+			  baseNodes += leaf->depth;
+			  aw += leaf->aw;
+			}
+	      }else{
+	      // only the items above h are counted
+	      for( i=1; i <= h; i++ ){
+			c->cnt[H->item[i]] = 0;
+			b->cnt[H->item[i]] = 0;
+			w->cnt[H->item[i]] = 0;
+	      }
+	      while( leaf != NULL ){
+			// CALC THE FREQ OF THE NODES IN THE CURRENT PATH
+			baseNodes += countFreq( leaf, c, b, w );
+			aw += leaf->aw;
+			leaf = leaf->nodeLink;
+	      }
+	      }
+
+	      //if( CNT_CCC ){
+		/* Upper bound: numSupCnt += H->hdrLen; */
+		/* Reasonable bound (impl): numSupCnt += h; */
+		/* Tighter bound: */
+			//for( i=1; i < h; i++ )
+				//if( c->cnt[H->item[i]] > 0 ) numSupCnt++;
+	      //}
+		#if CNT_FP
+	      (countL[MIN(1 + alpha->size,MAXLEVEL)])++;
+	    #endif
+//here print out the frequent patterns
+	      if( ! growPrefix( H, h, c, b, w, aw, alpha, alpha2, minSig, &I ) ){
+			// PRUNED: the parent still needs the info of the nodes
+			for( leaf = H->head[h]; leaf != NULL; leaf = leaf->nodeLink )
+			  passInfoUp( leaf );
+			continue;
+	      }
+	      for( leaf = H->head[h]; I != NULL && leaf != NULL; leaf = leaf->nodeLink )
+			addFPInfo( I, leaf->info );
+	      nNew = alpha2->size - alpha->size;
+
+	      if( sortTree ){	// conditional climp order; else the parent's
+			Q->size = 0;
+			for( i=1; i < h; i++ )
+			  if( c->cnt[H->item[i]] >= minSig ){
+				appendUQ( Q, c->cnt[H->item[i]], H->item[i] );
+			  }
+			sortDescUQ( Q );
+			if( DEBUG ) showHeapUQ( Q );
+
+			cleanHdr( LH );		// CREATE THE HEADER OF PROJECTED-DB
+			for( i=1; i <= Q->size; i++ )
+			  insertHdr( LH, Q->datum1[i], 0 ); //CHANGE THIS 0
+		  }else{ /* NO SORT_TREE */
+			cleanHdr( LH );
+			for( i=1; i < h; i++ )
+			  if( c->cnt[H->item[i]] >= minSig )
+				insertHdr( LH, H->item[i] , 0); //CHANGE THIS 0
+	      }
+		if(LH->hdrLen <= 0){
+			leaf = H->head[h];
+			while(leaf != NULL){
+				passInfoUp( leaf );
+				leaf = leaf->nodeLink;
+			}
+		}
+	      if( LH->hdrLen > 0 ){
+			// OVER BUDGET: the projection has at most baseNodes nodes
+			if( memBudget > 0 &&
+			    memUsed + (long)(baseNodes + 1) * (long)sizeof(TreeNode) > memBudget ){
+			  spillBase( LH, H->head[h], c, alpha2, nNew, minSig );
+			  basesBy[BASE_SPILL]++;
+			  continue;
+			}
+
+			// SMALL BASE: mine in place over the parent tree
+			if( baseNodes <= pseudoMax ){
+			  refs = (PathRef *)malloc( (H->nodeCnt[h] + 1) * sizeof(PathRef) );
+			  if( refs == NULL ){
+			    fprintf( stderr, "ERROR[FPgrowth]\n" );
+			    exit( 0 );
+			  }
+			  nRefs = 0;
+			  leaf = H->head[h];
+			  while( leaf != NULL ){
+			    passInfoUp( leaf );
+			    refs[nRefs].node = leaf->parent;
+			    refs[nRefs].count = leaf->count;
+			    refs[nRefs].bound = leaf->bound;
+			    refs[nRefs].aw = prefixWeight( leaf, leaf->wv, leaf->aw, alpha2, nNew );
+			    refs[nRefs].wv = leaf->wv;
+			    refs[nRefs].info = leaf->info;
+			    nRefs++;
+			    leaf = leaf->nodeLink;
+			  }
+			  pseudoGrowth( LH, refs, nRefs, alpha2, minSig );
+			  free( refs );
+			  basesBy[BASE_PSEUDO]++;
+			  continue;
+			}
+
+			// DENSE BASE: paths that fill a small header and barely share
+			// their prefixes in the parent tree, so a projection would not either
+			if( engine == ENGINE_HYBRID && LH->hdrLen <= HYBRID_MAX_HDR &&
+			    100L * treeNodes >= (long)HYBRID_SPREAD * H->cells &&
+			    100L * baseCells( LH, H->head[h] ) >= (long)HYBRID_DENSITY * H->nodeCnt[h] * LH->hdrLen ){
+			  vertBase( LH, H->head[h], c, alpha2, nNew, minSig );
+			  basesBy[BASE_BITMAP]++;
+			  continue;
+			}
+
+			basesBy[BASE_TREE]++;
+			initPairs( LH );
+			bTree = createNewNode( ROOT, 1 ); // PROJ-TREE ROOT NODE
+			leaf = H->head[h];
+			while( leaf != NULL ){			// BUILD THE PROJ-TREE
+			  passInfoUp( leaf );
+			  getRevList( c, leaf->parent, list, minSig, leaf->wv );
+			  if( list->size > 0 ){
+				aw = prefixWeight( leaf, leaf->wv, leaf->aw, alpha2, nNew );
+				if( sortTree ){
+				  sortList( list, RList, c );
+				  insertTree( LH, RList, leaf->info, leaf->count, aw, 1, RList->size, bTree );
+				}else{
+				  // list runs bottom-up: insert from its top item down
+				  insertTreeRev( LH, list, leaf->info, leaf->count, aw, list->size, 1, bTree );
+				}
+			  }
+			  leaf = leaf->nodeLink;
+			}
+
+			if( compactTrees )
+			  bTree = compactTree( LH, bTree, COMPACT_NODES );
+			if( DEBUG ){
+			  showFullHdr( LH );
+			  showTree2( bTree );
+			}
+			FPgrowth( LH, bTree, alpha2, countMem(memSpc,LH), minSig );
+			freeTree( bTree, LH );
+	      }
+	  }
+	  for( leaf = H->head[1]; H->hdrLen > 0 && ! (growShared && frameDepth == 1) && leaf != NULL; leaf = leaf->nodeLink )
+		releaseWeights( leaf );
+  }
+  leaveFrame();
+  if( timed ) phaseEnd();
+  if( DEBUG ) printf( "FP growth: Completed\n" );
+}
+
+/* ======================================================================= */
+
+/*
+  Server mode (-S socket). The tree is built once, for the minSig given
+  on the command line, and stays resident and read-only: settleTree
+  passes every node's info and weights up once, as the top level of
+  FPgrowth would, and the queries mine it with growShared set. Every
+  query line on the Unix socket
+
+      minSig [friend [k]]
+
+  is answered by mining the shared tree on the connection's thread,
+  whose projections are private: groups reaching minSig (not below the
+  build minSig), only those with friend when it is not 0, and only the
+  k with the largest dgimp, largest first, when k is not 0. The answer
+  is one NDJSON line per group (see writeItemset) and a last line
+  {"found":n}. "shutdown" stops the server once the open connections
+  are done.
+
+  A required friend is the lowest ranked item of every group with it in
+  one of the branches from the friend's header position down, so the
+  top level skips the branches above it; the header's lgwt (the climp
+  of each item) rejects friends that cannot reach minSig.
+*/
+
+/* passes the info and weights of every node up, deepest header positions first */
+void settleTree( Header *H ){
+  TreeNode *leaf;
+  int h;
+
+  for( h = H->hdrLen; h >= 1; h-- )
+    for( leaf = H->head[h]; leaf != NULL; leaf = leaf->nodeLink )
+      passInfoUp( leaf );
+}
+
+/* larger dgimp first, then the order found */
+int cmpPickDesc( const void *a, const void *b ){
+  int x = *(const int *)a, y = *(const int *)b;
+
+  if( FP[x].dgimp != FP[y].dgimp )
+    return FP[x].dgimp > FP[y].dgimp ? -1 : 1;
+  return x - y;
+}
+
+void answerQuery( Server *S, OutWriter *W, double minSig, int friend, int topK ){
+  shortList nullList;
+  weight_t minClimp;
+  int i, n, rank, *pick;
+  char tmp[32];
+
+  minClimp = MIN_CLIMP( S->dlimpDB, minSig );
+  rank = (friend >= 1 && friend <= MAXITEMS) ? S->H->mapHdr[friend] : 0;
+  clearFP();
+  if( friend == 0 || (rank > 0 && S->H->lgwt[rank] >= minClimp) ){
+    growFloor = (friend == 0 ? 1 : rank);
+    growShared = TRUE;
+    nullList.size = 0;
+    FPgrowth( S->H, S->root, &nullList, countMem(0,S->H), minClimp );
+    growShared = FALSE;
+    growFloor = 1;
+    mineSpilled( minClimp );
+    filterFP();
+  }
+
+  pick = (int *)malloc( (sizeFP + 1) * sizeof(int) );
+  if( pick == NULL ){
+    fprintf( stderr, "ERROR[answerQuery]\n" );
+    exit( 0 );
+  }
+  for( i = 0, n = 0; i < sizeFP; i ++ )
+    if( FP[i].dgimp >= minClimp && (friend == 0 || has_item( &FP[i], friend ) == true) )
+      pick[n++] = i;
+  if( topK > 0 ){	// ranked even when all of them fit in k
+    qsort( pick, n, sizeof(int), cmpPickDesc );
+    n = MIN( n, topK );
+  }
+  for( i = 0; i < n; i ++ )
+    writeItemset( W, &FP[pick[i]], S->dlimpDB );
+  snprintf( tmp, sizeof(tmp), "{\"found\":%d}\n", n );
+  obPuts( &W->file, tmp );
+  flushWriter( W );
+
+  for( i = 0; i < sizeFP; i ++ )
+    release_info( FP[i].info );
+  clearFP();
+  free( pick );
+}
+
+void stopServer( Server *S ){
+  pthread_mutex_lock( &S->mu );
+  S->stop = TRUE;
+  shutdown( S->listenFd, SHUT_RDWR );	// wakes up accept
+  pthread_mutex_unlock( &S->mu );
+}
+
+void *connMain( void *arg ){
+  ServerConn *C = (ServerConn *)arg;
+  Server *S = C->S;
+  FILE *in, *out;
+  OutWriter W;
+  char line[256];
+  double sig;
+  int friend, topK;
+
+  allocFP();
+  in = fdopen( C->fd, "r" );
+  out = fdopen( dup( C->fd ), "w" );
+  if( in == NULL || out == NULL ){
+    fprintf( stderr, "ERROR[connMain]: Can't open the connection\n" );
+    exit( 0 );
+  }
+  openWriter( &W, out, OUT_NDJSON, FALSE );
+  while( fgets( line, sizeof(line), in ) != NULL ){
+    if( strncmp( line, "shutdown", 8 ) == 0 ){
+      stopServer( S );
+      break;
+    }
+    friend = topK = 0;
+    if( sscanf( line, "%lf %d %d", &sig, &friend, &topK ) < 1 ){
+      obPuts( &W.file, "{\"error\":\"expected: minSig [friend [k]]\"}\n" );
+    }else if( sig < S->minSig ){
+      obPuts( &W.file, "{\"error\":\"minSig below the minSig the tree was built for\"}\n" );
+    }else{
+      answerQuery( S, &W, sig, friend, topK );
+    }
+    flushWriter( &W );
+    fflush( out );
+  }
+  closeWriter( &W );
+  fclose( out );
+  fclose( in );
+  freeFrames();
+  freeFP();
+  free( C );
+
+  pthread_mutex_lock( &S->mu );
+  S->active--;
+  pthread_cond_signal( &S->idle );
+  pthread_mutex_unlock( &S->mu );
+  return NULL;
+}
+
+void serveQueries( const char *path, Header *H, TreeNode *root, weight_t dlimpDB, double minSig ){
+  Server S;
+  ServerConn *C;
+  struct sockaddr_un addr;
+  pthread_attr_t attr;
+  pthread_t tid;
+  int fd;
+
+  S.H = H;
+  S.root = root;
+  S.dlimpDB = dlimpDB;
+  S.minSig = minSig;
+  S.active = 0;
+  S.stop = FALSE;
+  pthread_mutex_init( &S.mu, NULL );
+  pthread_cond_init( &S.idle, NULL );
+
+  memset( &addr, 0, sizeof(addr) );
+  addr.sun_family = AF_UNIX;
+  if( strlen( path ) >= sizeof(addr.sun_path) ){
+    fprintf( stderr, "ERROR[serveQueries]: Socket path too long: %s\n", path );
+    exit( 0 );
+  }
+  strcpy( addr.sun_path, path );
+  S.listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+  unlink( path );
+  if( S.listenFd < 0 || bind( S.listenFd, (struct sockaddr *)&addr, sizeof(addr) ) != 0 ||
+      listen( S.listenFd, SOMAXCONN ) != 0 ){
+    fprintf( stderr, "ERROR[serveQueries]: Can't listen on %s\n", path );
+    exit( 0 );
+  }
+  signal( SIGPIPE, SIG_IGN );	// a client that goes away is not fatal
+  echoCandidates = FALSE;
+  settleTree( H );
+  printf( "\n[SF-Tree] Serving minSig >= %f on %s\n", minSig, path );
+  fflush( stdout );
+
+  pthread_attr_init( &attr );
+  pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+  while( TRUE ){
+    fd = accept( S.listenFd, NULL, NULL );
+    if( fd < 0 ){
+      if( errno == EINTR && ! S.stop ) continue;
+      break;
+    }
+    C = (ServerConn *)malloc( sizeof(ServerConn) );
+    if( C == NULL ){
+      fprintf( stderr, "ERROR[serveQueries]\n" );
+      exit( 0 );
+    }
+    C->S = &S;
+    C->fd = fd;
+    pthread_mutex_lock( &S.mu );
+    S.active++;
+    pthread_mutex_unlock( &S.mu );
+    if( pthread_create( &tid, &attr, connMain, C ) != 0 ){
+      fprintf( stderr, "ERROR[serveQueries]: Can't start a connection thread\n" );
+      exit( 0 );
+    }
+  }
+  pthread_attr_destroy( &attr );
+
+  pthread_mutex_lock( &S.mu );
+  while( S.active > 0 )
+    pthread_cond_wait( &S.idle, &S.mu );
+  pthread_mutex_unlock( &S.mu );
+  close( S.listenFd );
+  unlink( path );
+  pthread_mutex_destroy( &S.mu );
+  pthread_cond_destroy( &S.idle );
+}
+
+/* ======================================================================= */
+
+/*
+  Transaction input. A TransReader parses the database with its own
+  buffer; readTrans returns one transaction (pid, then item/weight
+  pairs) as it is in the file.
+*/
+
+void openReader( TransReader *R, FILE *fp ){
+  R->fp = fp;
+  R->pos = R->len = 0;
+  R->buf = (char *)malloc( READ_BUF_SIZE );
+  if( R->buf == NULL ){
+    fprintf( stderr, "ERROR[openReader]\n" );
+    exit( 0 );
+  }
+}
+
+void rewindReader( TransReader *R ){
+  rewind( R->fp );
+  R->pos = R->len = 0;
+}
+
+void closeReader( TransReader *R ){
+  free( R->buf );
+}
+
+/* next integer of the input; FALSE at the end */
+int readInt( TransReader *R, int *v ){
+  int c, neg = 0;
+  long long x = 0;
+
+  for( ;; ){
+    if( R->pos == R->len ){
+      R->len = fread( R->buf, 1, READ_BUF_SIZE, R->fp );
+      R->pos = 0;
+      if( R->len == 0 ) return FALSE;
+    }
+    c = R->buf[R->pos];
+    if( c != ' ' && c != '\t' && c != '\n' && c != '\r' ) break;
+    R->pos++;
+  }
+  if( c == '-' || c == '+' ){
+    neg = (c == '-');
+    R->pos++;
+  }
+  for( ;; ){
+    if( R->pos == R->len ){
+      R->len = fread( R->buf, 1, READ_BUF_SIZE, R->fp );
+      R->pos = 0;
+      if( R->len == 0 ) break;
+    }
+    c = R->buf[R->pos];
+    if( c < '0' || c > '9' ) break;
+    x = 10 * x + (c - '0');
+    R->pos++;
+  }
+  *v = (int)(neg ? -x : x);
+  return TRUE;
+}
+
+void readTrans( TransReader *R, RawTrans *T ){
+  int j;
+
+  if( ! readInt( R, &T->pid ) || ! readInt( R, &T->n ) || T->n < 0 ){
+    fprintf( stderr, "ERROR[readTrans]: Truncated database\n" );
+    exit( 0 );
+  }
+  if( T->n > T->cap ){
+    T->cap = MAX( T->n, 2 * T->cap );
+    T->item = (int *)realloc( T->item, T->cap * sizeof(int) );
+    T->weight = (int *)realloc( T->weight, T->cap * sizeof(int) );
+    if( T->item == NULL || T->weight == NULL ){
+      fprintf( stderr, "ERROR[readTrans]\n" );
+      exit( 0 );
+    }
+  }
+  for( j=0; j < T->n; j++ )
+    if( ! readInt( R, &T->item[j] ) || ! readInt( R, &T->weight[j] ) ||
+        T->item[j] < 1 || T->item[j] > MAXITEMS ){
+      fprintf( stderr, "ERROR[readTrans]: Bad transaction %d\n", T->pid );
+      exit( 0 );
+    }
+}
+
+/*
+  Edge-list input (-e). The database is "src dst weight" triples in any
+  order, each source a transaction and each edge one of its item/weight
+  pairs. groupEdges reads the edges in runs of at most the memory budget
+  (-m, else EDGE_RUN edges), sorts each run by (src, dst) and spills it
+  to a temp file, then merges the runs with a heap into a database in
+  the usual format: one transaction per source, ascending, a repeated
+  edge once with its weights summed. The transaction count goes over a
+  blank first line at the end. The file is named so the -P workers can
+  open it, and removed at exit.
+*/
+char edgeDbPath[4096];
+
+void removeEdgeDb( void ){
+  if( edgeDbPath[0] != '\0' )
+    unlink( edgeDbPath );
+}
+
+int cmpEdge( const void *a, const void *b ){
+  const Edge *x = (const Edge *)a, *y = (const Edge *)b;
+
+  if( x->src != y->src ) return x->src < y->src ? -1 : 1;
+  if( x->dst != y->dst ) return x->dst < y->dst ? -1 : 1;
+  return 0;
+}
+
+/* edge number e of the input; FALSE at the end */
+int readEdge( TransReader *R, Edge *E, long e ){
+  if( ! readInt( R, &E->src ) ) return FALSE;
+  if( ! readInt( R, &E->dst ) || ! readInt( R, &E->weight ) || E->dst < 1 || E->dst > MAXITEMS ){
+    fprintf( stderr, "ERROR[readEdge]: Bad edge %ld\n", e );
+    exit( 0 );
+  }
+  return TRUE;
+}
+
+/* advances run U; FALSE when it is exhausted */
+int nextRunEdge( EdgeRun *U ){
+  if( U->fp == NULL ){
+    if( U->pos == U->n ) return FALSE;
+    U->head = U->mem[U->pos++];
+    return TRUE;
+  }
+  return fread( &U->head, sizeof(Edge), 1, U->fp ) == 1;
+}
+
+/* restores the min-heap of run indices below position i */
+void siftRuns( EdgeRun *runs, int *heap, int size, int i ){
+  int c, x = heap[i];
+
+  while( (c = 2 * i + 1) < size ){
+    if( c + 1 < size && cmpEdge( &runs[heap[c+1]].head, &runs[heap[c]].head ) < 0 ) c++;
+    if( cmpEdge( &runs[heap[c]].head, &runs[x].head ) >= 0 ) break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = x;
+}
+
+/* appends transaction src with its edges grp[0..len) */
+void writeGroup( OutBuf *B, int src, Edge *grp, int len ){
+  int j;
+
+  obInt( B, src );
+  obPuts( B, "\t" );
+  obInt( B, len );
+  for( j=0; j < len; j++ ){
+    obPuts( B, j ? " " : "\t" );
+    obInt( B, grp[j].dst );
+    obPuts( B, " " );
+    obInt( B, grp[j].weight );
+  }
+  obPuts( B, "\n" );
+}
+
+FILE *groupEdges( const char *file, long budget, long *numEdges, int *numRuns ){
+  char path[4096];
+  const char *dir;
+  FILE *in, *out;
+  TransReader R;
+  OutBuf B;
+  EdgeRun *runs = NULL;
+  Edge *run, *grp = NULL, *E;
+  long cap, n, total = 0;
+  int *heap, i, nRuns = 0, size, numTrans = 0, len = 0, grpCap = 0, fd;
+
+  if( (in = fopen( file, "r" )) == NULL ) return NULL;
+  cap = budget > 0 ? MAX( budget / (long)sizeof(Edge), 1024 ) : EDGE_RUN;
+  run = (Edge *)malloc( cap * sizeof(Edge) );
+  if( run == NULL ){
+    fprintf( stderr, "ERROR[groupEdges]\n" );
+    exit( 0 );
+  }
+  openReader( &R, in );
+  do{
+    for( n = 0; n < cap && readEdge( &R, &run[n], total + n + 1 ); n++ );
+    total += n;
+    if( n == 0 && nRuns > 0 ) break;
+    qsort( run, n, sizeof(Edge), cmpEdge );
+    runs = (EdgeRun *)realloc( runs, (nRuns + 1) * sizeof(EdgeRun) );
+    if( runs == NULL ){
+      fprintf( stderr, "ERROR[groupEdges]\n" );
+      exit( 0 );
+    }
+    runs[nRuns].mem = run;
+    runs[nRuns].pos = 0;
+    runs[nRuns].n = n;
+    runs[nRuns].fp = NULL;
+    if( n == cap || nRuns > 0 ){	// more than one run: all go to disk
+      runs[nRuns].fp = spillFile();
+      if( fwrite( run, sizeof(Edge), n, runs[nRuns].fp ) != (size_t)n ){
+        fprintf( stderr, "ERROR[groupEdges]: Write failed\n" );
+        exit( 0 );
+      }
+      rewind( runs[nRuns].fp );
+    }
+    nRuns++;
+  }while( n == cap );
+  closeReader( &R );
+  fclose( in );
+  if( runs[0].fp != NULL ){
+    free( run );
+    run = NULL;
+  }
+
+  dir = getenv( "TMPDIR" );
+  if( dir == NULL || *dir == '\0' ) dir = "/tmp";
+  snprintf( path, sizeof(path), "%s/sftree-edges-XXXXXX", dir );
+  fd = mkstemp( path );
+  if( fd < 0 || (out = fdopen( fd, "w+" )) == NULL ){
+    fprintf( stderr, "ERROR[groupEdges]: Can't create %s\n", path );
+    exit( 0 );
+  }
+  snprintf( edgeDbPath, sizeof(edgeDbPath), "%s", path );
+  atexit( removeEdgeDb );
+  B.fp = out;
+  B.len = 0;
+  B.buf = (char *)malloc( OUT_BUF_SIZE );
+  heap = (int *)malloc( nRuns * sizeof(int) );
+  if( B.buf == NULL || heap == NULL ){
+    fprintf( stderr, "ERROR[groupEdges]\n" );
+    exit( 0 );
+  }
+  obPuts( &B, "            \n" );	// the count, later
+
+  size = 0;
+  for( i=0; i < nRuns; i++ )
+    if( nextRunEdge( &runs[i] ) )
+      heap[size++] = i;
+  for( i = size / 2 - 1; i >= 0; i-- )
+    siftRuns( runs, heap, size, i );
+  while( size > 0 ){
+    E = &runs[heap[0]].head;
+    if( len > 0 && grp[0].src != E->src ){
+      writeGroup( &B, grp[0].src, grp, len );
+      numTrans++;
+      len = 0;
+    }
+    if( len > 0 && grp[len-1].dst == E->dst ){
+      grp[len-1].weight += E->weight;
+    }else{
+      if( len == grpCap ){
+        grpCap = grpCap ? 2 * grpCap : 64;
+        grp = (Edge *)realloc( grp, grpCap * sizeof(Edge) );
+        if( grp == NULL ){
+          fprintf( stderr, "ERROR[groupEdges]\n" );
+          exit( 0 );
+        }
+      }
+      grp[len++] = *E;
+    }
+    if( ! nextRunEdge( &runs[heap[0]] ) )
+      heap[0] = heap[--size];
+    siftRuns( runs, heap, size, 0 );
+  }
+  if( len > 0 ){
+    writeGroup( &B, grp[0].src, grp, len );
+    numTrans++;
+  }
+  obFlush( &B );
+  if( fseek( out, 0, SEEK_SET ) != 0 || fprintf( out, "%d", numTrans ) < 0 || fflush( out ) != 0 ){
+    fprintf( stderr, "ERROR[groupEdges]: Write failed\n" );
+    exit( 0 );
+  }
+  rewind( out );
+
+  for( i=0; i < nRuns; i++ )
+    if( runs[i].fp != NULL )
+      fclose( runs[i].fp );
+  *numEdges = total;
+  *numRuns = nRuns;
+  free( runs );
+  free( B.buf );
+  free( heap );
+  free( grp );
+  free( run );
+  return out;
+}
+
+/*
+  Keeps the items of T with climp >= minClimp, once each, in descending
+  climp order (ascending item on ties) with their weight in T as key,
+  and takes the weight of the other items off limp[transInd].
+*/
+void prepareTrans( ScanCtx *X, PrepScratch *S, RawTrans *T, int transInd, shortList *SQ ){
+  int j, item;
+  weight_t w;
+
+  S->stamp++;
+  SQ->size = 0;
+  for( j=0; j < T->n; j++ ){
+    item = T->item[j];
+    w = (weight_t)T->weight[j] * X->confidence[item];
+    if( X->climp[item] < X->minClimp ){
+      X->limp[transInd] -= w;
+    }else{
+      if( S->seen[item] != S->stamp ){
+        S->seen[item] = S->stamp;
+        S->tw[item] = 0;
+        appendUList( SQ, X->order[item], item );
+      }
+      S->tw[item] += w;
+    }
+  }
+  sortDescUList( SQ );
+  for( j=1; j <= SQ->size; j++ )
+    SQ->key[j] = S->tw[SQ->datum1[j]];
+  // a partition needs the transaction only down to its last own item
+  if( X->part != NULL ){
+    for( j = SQ->size; j >= 1 && ! X->part[SQ->datum1[j]]; j-- );
+    SQ->size = j;
+  }
+}
+
+PrepScratch *newScratch( void ){
+  PrepScratch *S = (PrepScratch *)calloc( 1, sizeof(PrepScratch) );
+
+  if( S == NULL ){
+    fprintf( stderr, "ERROR[newScratch]\n" );
+    exit( 0 );
+  }
+  return S;
+}
+
+/* ======================================================================= */
+
+/*
+  Tree-construction pipeline: reader thread -> worker threads (filter
+  and sort) -> main thread (insert). Batches circulate through three
+  bounded queues; the pool holds 2 * workers + 2 of them, which bounds
+  the memory in flight. Workers finish batches out of order, the
+  inserter puts them back in sequence so the tree is the same as with
+  the serial loop.
+*/
+
+void initQueue( BatchQueue *Q, int cap ){
+  Q->slot = (TransBatch **)malloc( cap * sizeof(TransBatch *) );
+  if( Q->slot == NULL ){
+    fprintf( stderr, "ERROR[initQueue]\n" );
+    exit( 0 );
+  }
+  Q->cap = cap;
+  Q->head = Q->count = 0;
+  Q->closed = FALSE;
+  pthread_mutex_init( &Q->mu, NULL );
+  pthread_cond_init( &Q->notEmpty, NULL );
+  pthread_cond_init( &Q->notFull, NULL );
+}
+
+void destroyQueue( BatchQueue *Q ){
+  pthread_mutex_destroy( &Q->mu );
+  pthread_cond_destroy( &Q->notEmpty );
+  pthread_cond_destroy( &Q->notFull );
+  free( Q->slot );
+}
+
+void pushBatch( BatchQueue *Q, TransBatch *B ){
+  pthread_mutex_lock( &Q->mu );
+  while( Q->count == Q->cap )
+    pthread_cond_wait( &Q->notFull, &Q->mu );
+  Q->slot[(Q->head + Q->count) % Q->cap] = B;
+  Q->count++;
+  pthread_cond_signal( &Q->notEmpty );
+  pthread_mutex_unlock( &Q->mu );
+}
+
+/* NULL once the queue is closed and empty */
+TransBatch *popBatch( BatchQueue *Q ){
+  TransBatch *B = NULL;
+
+  pthread_mutex_lock( &Q->mu );
+  while( Q->count == 0 && ! Q->closed )
+    pthread_cond_wait( &Q->notEmpty, &Q->mu );
+  if( Q->count > 0 ){
+    B = Q->slot[Q->head];
+    Q->head = (Q->head + 1) % Q->cap;
+    Q->count--;
+    pthread_cond_signal( &Q->notFull );
+  }
+  pthread_mutex_unlock( &Q->mu );
+  return B;
+}
+
+void closeQueue( BatchQueue *Q ){
+  pthread_mutex_lock( &Q->mu );
+  Q->closed = TRUE;
+  pthread_cond_broadcast( &Q->notEmpty );
+  pthread_mutex_unlock( &Q->mu );
+}
+
+void *readerMain( void *arg ){
+  Pipeline *PL = (Pipeline *)arg;
+  TransBatch *B;
+  int seq = 0, t = 1;
+
+  while( t <= PL->numTrans ){
+    B = popBatch( &PL->freeQ );
+    B->seq = seq++;
+    B->first = t;
+    for( B->n = 0; B->n < PIPE_BATCH && t <= PL->numTrans; B->n++, t++ )
+      readTrans( PL->R, &B->raw[B->n] );
+    pushBatch( &PL->workQ, B );
+  }
+  B = popBatch( &PL->freeQ );	// end of input
+  B->seq = seq;
+  B->n = 0;
+  pushBatch( &PL->workQ, B );
+  closeQueue( &PL->workQ );
+  return NULL;
+}
+
+void *workerMain( void *arg ){
+  Pipeline *PL = (Pipeline *)arg;
+  PrepScratch *S = newScratch();
+  TransBatch *B;
+  int k, j, len;
+
+  while( (B = popBatch( &PL->workQ )) != NULL ){
+    len = 0;
+    for( k=0; k < B->n; k++ ){
+      prepareTrans( PL->X, S, &B->raw[k], B->first + k, &S->SQ );
+      if( len + S->SQ.size > B->cap ){
+        B->cap = MAX( len + S->SQ.size, 2 * B->cap );
+        B->items = (int *)realloc( B->items, B->cap * sizeof(int) );
+        B->keys = (weight_t *)realloc( B->keys, B->cap * sizeof(weight_t) );
+        if( B->items == NULL || B->keys == NULL ){
+          fprintf( stderr, "ERROR[workerMain]\n" );
+          exit( 0 );
+        }
+      }
+      B->start[k] = len;
+      for( j=1; j <= S->SQ.size; j++, len++ ){
+        B->items[len] = S->SQ.datum1[j];
+        B->keys[len] = S->SQ.key[j];
+      }
+    }
+    B->start[B->n] = len;
+    pushBatch( &PL->doneQ, B );
+  }
+  free( S );
+  return NULL;
+}
+
+/* second pass: insert every transaction, in input order */
+/*
+  Deduplication of the filtered, sorted transactions. Transactions
+  with the same item list are staged as one entry: counts and item
+  weights are summed and the transaction numbers collected in one info,
+  so each distinct list takes one insertTree walk. Entries are inserted
+  in the order first seen, which builds the same tree as inserting the
+  transactions one by one.
+*/
+
+void initDedup( DedupTable *D ){
+  D->size = D->cap = 0;
+  D->entry = NULL;
+  D->mask = 1023;
+  D->slot = (int *)calloc( D->mask + 1, sizeof(int) );
+  D->merged = 0;
+  if( D->slot == NULL ){
+    fprintf( stderr, "ERROR[initDedup]\n" );
+    exit( 0 );
+  }
+}
+
+/* FNV-1a over the items */
+uint64_t hashList( shortList *SQ ){
+  uint64_t h = 14695981039346656037ULL;
+  int j;
+
+  for( j=1; j <= SQ->size; j++ ){
+    h ^= (uint64_t)(unsigned)SQ->datum1[j];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+void growDedup( DedupTable *D ){
+  int i, k;
+
+  free( D->slot );
+  D->mask = 2 * D->mask + 1;
+  D->slot = (int *)calloc( D->mask + 1, sizeof(int) );
+  if( D->slot == NULL ){
+    fprintf( stderr, "ERROR[growDedup]\n" );
+    exit( 0 );
+  }
+  for( i=0; i < D->size; i++ ){
+    for( k = D->entry[i].hash & D->mask; D->slot[k] != 0; k = (k + 1) & D->mask );
+    D->slot[k] = i + 1;
+  }
+}
+
+void stageTrans( DedupTable *D, shortList *SQ, int tid, weight_t count ){
+  DedupEntry *E;
+  uint64_t h;
+  int j, k;
+
+  if( SQ->size == 0 ) return;	// nothing to insert
+  h = hashList( SQ );
+  for( k = h & D->mask; D->slot[k] != 0; k = (k + 1) & D->mask ){
+    E = &D->entry[D->slot[k] - 1];
+    if( E->hash != h || E->n != SQ->size ) continue;
+    for( j=1; j <= SQ->size && E->items[j-1] == SQ->datum1[j]; j++ );
+    if( j <= SQ->size ) continue;
+    for( j=1; j <= SQ->size; j++ )
+      E->keys[j-1] += SQ->key[j];
+    E->count += count;
+    append_friend( E->info, tid );
+    D->merged++;
+    return;
+  }
 
-  L = MAX(k, n-k);
-  S = MIN(k, n-k);
+  if( D->size == D->cap ){
+    D->cap = (D->cap == 0 ? 1024 : 2 * D->cap);
+    D->entry = (DedupEntry *)realloc( D->entry, D->cap * sizeof(DedupEntry) );
+    if( D->entry == NULL ){
+      fprintf( stderr, "ERROR[stageTrans]\n" );
+      exit( 0 );
+    }
+  }
+  E = &D->entry[D->size];
+  E->hash = h;
+  E->n = SQ->size;
+  E->items = (int *)malloc( SQ->size * sizeof(int) );
+  E->keys = (weight_t *)malloc( SQ->size * sizeof(weight_t) );
+  if( E->items == NULL || E->keys == NULL ){
+    fprintf( stderr, "ERROR[stageTrans]\n" );
+    exit( 0 );
+  }
+  for( j=1; j <= SQ->size; j++ ){
+    E->items[j-1] = SQ->datum1[j];
+    E->keys[j-1] = SQ->key[j];
+  }
+  E->count = count;
+  E->info = create_info( tid );
+  D->slot[k] = ++(D->size);
+  if( 2 * D->size > D->mask )
+    growDedup( D );
+}
 
-  prod = 1;
-  for( i=n; i >= L+1; i-- )
-    prod *= i;
-  for( i=S; i >= 2; i-- )
-    prod /= i;
-  return prod;
+/* one filtered transaction: into the tree, or a row of V when V is not NULL */
+void insertRow( Header *H, shortList *SQ, PersonalInfo *P, weight_t count, TreeNode *root, Vertical *V ){
+  if( V == NULL )
+    insertTree( H, SQ, P, count, 0, 1, SQ->size, root );
+  else if( SQ->size > 0 )
+    addRow( V, H, SQ, count, 0, P );
 }
 
-/* mine( head | tail ) */
-void mine( shortList *head, shortList *tail ){
-  int j, k;
-  shortList head2;
-  shortList tail2;
+/* inserts the staged entries and empties D */
+void insertStaged( DedupTable *D, Header *H, TreeNode *root, Vertical *V ){
+  DedupEntry *E;
+  shortList SQ;
+  int i, j;
 
-  if( head->size == 0 ){
-    fprintf( stderr, "ERROR[mine]: Infrequent (0H)\n" );
-    exit( -1 );
+  for( i=0; i < D->size; i++ ){
+    E = &D->entry[i];
+    SQ.size = E->n;
+    for( j=1; j <= E->n; j++ ){
+      SQ.datum1[j] = E->items[j-1];
+      SQ.key[j] = E->keys[j-1];
+    }
+    insertRow( H, &SQ, E->info, E->count, root, V );
+    release_info( E->info );
+    free( E->items );
+    free( E->keys );
   }
+  if( D->merged > 0 )
+    printf( "\n[SF-Tree] Inserted %d distinct transactions for %d\n", D->size, D->size + D->merged );
+  free( D->entry );
+  free( D->slot );
+}
 
-  if( CNT_FP ){
-    for( k = 1; k <= head->size; k++ )
-      countL[MIN(k + tail->size,MAXLEVEL)] += choose(head->size,k);
+void insertTransactions( TransReader *R, int numTrans, ScanCtx *X, Header *H, TreeNode *root,
+			 Vertical *V, int workers ){
+  Pipeline PL;
+  pthread_t reader, *worker;
+  TransBatch *pool, **pending, *B;
+  PrepScratch *S;
+  PersonalInfo *P;
+  RawTrans T;
+  DedupTable D;
+  int i, j, k, nPool, next;
+
+  if( DEDUP_TRANS ) initDedup( &D );
+  if( workers <= 0 ){
+    S = newScratch();
+    T.cap = 0;
+    T.item = T.weight = NULL;
+    for( i=1; i <= numTrans; i++ ){
+      readTrans( R, &T );
+      prepareTrans( X, S, &T, i, &S->SQ );
+      if( DEDUP_TRANS ){
+        stageTrans( &D, &S->SQ, i, X->limp[i] );
+      }else{
+        P = create_info( i );
+        insertRow( H, &S->SQ, P, X->limp[i], root, V );
+        release_info( P );
+      }
+    }
+    if( DEDUP_TRANS ) insertStaged( &D, H, root, V );
+    free( T.item );
+    free( T.weight );
+    free( S );
     return;
   }
 
-  if( head->size == 1 ){
-    (countL[MIN(1 + tail->size,MAXLEVEL)])++;
-    //if( PRT_FP ){
-    //  if( head->key[1] >= minsup ){
-	//	showFP( head->datum1[1], tail, head->key[1] );
-    // }else{
-	//	fprintf( stderr, "ERROR[mine]: Infrequent (1H)\n" );
-	//	exit( -1 );
-    // }
-    //}
-  }else{
-    for( k = tail->size; k >= 1; k-- ){
-      tail2.datum1[k+1] = tail->datum1[k];
-      tail2.key[k+1] = tail->key[k];
+  nPool = 2 * workers + 2;
+  pool = (TransBatch *)calloc( nPool, sizeof(TransBatch) );
+  pending = (TransBatch **)calloc( nPool, sizeof(TransBatch *) );
+  worker = (pthread_t *)malloc( workers * sizeof(pthread_t) );
+  S = newScratch();
+  if( pool == NULL || pending == NULL || worker == NULL ){
+    fprintf( stderr, "ERROR[insertTransactions]\n" );
+    exit( 0 );
+  }
+  PL.R = R;
+  PL.numTrans = numTrans;
+  PL.X = X;
+  initQueue( &PL.freeQ, nPool );
+  initQueue( &PL.workQ, nPool );
+  initQueue( &PL.doneQ, nPool );
+  for( i=0; i < nPool; i++ )
+    pushBatch( &PL.freeQ, &pool[i] );
+
+  if( pthread_create( &reader, NULL, readerMain, &PL ) != 0 ){
+    fprintf( stderr, "ERROR[insertTransactions]: Can't start the reader\n" );
+    exit( 0 );
+  }
+  for( i=0; i < workers; i++ )
+    if( pthread_create( &worker[i], NULL, workerMain, &PL ) != 0 ){
+      fprintf( stderr, "ERROR[insertTransactions]: Can't start worker %d\n", i );
+      exit( 0 );
     }
-    tail2.size = tail->size + 1;
 
-    for( k = 1; k < head->size; k++ ){
-      head2.datum1[k] = head->datum1[k];
-      head2.key[k] = head->key[k];
+  for( next = 0; ; next++ ){
+    while( pending[next % nPool] == NULL ){
+      B = popBatch( &PL.doneQ );
+      pending[B->seq % nPool] = B;
     }
-
-    for( j = head->size; j >= 1; j-- ){
-      #if CNT_FP
-	    (countL[MIN(tail2.size,MAXLEVEL)])++;
-	  #endif
-//      if( PRT_FP ){
-//		if( head->key[j] >= minsup ){
-//		  showFP( head->datum1[j], tail, head->key[1] );
-//		}else{
-//		  fprintf( stderr, "ERROR[mine]: Infrequent (mH)\n" );
-//		  exit( -1 );
-//		}
-//      }
-      if( j >= 2 ){
-	head2.size = j - 1;
-	tail2.datum1[1] = head->datum1[j];
-	tail2.key[1] = head->key[j];
-	mine( &head2, &tail2 );
+    B = pending[next % nPool];
+    pending[next % nPool] = NULL;
+    if( B->n == 0 ) break;
+    for( k=0; k < B->n; k++ ){
+      S->SQ.size = B->start[k+1] - B->start[k];
+      for( j=1; j <= S->SQ.size; j++ ){
+        S->SQ.datum1[j] = B->items[B->start[k] + j - 1];
+        S->SQ.key[j] = B->keys[B->start[k] + j - 1];
+      }
+      if( DEDUP_TRANS ){
+        stageTrans( &D, &S->SQ, B->first + k, X->limp[B->first + k] );
+      }else{
+        P = create_info( B->first + k );
+        insertRow( H, &S->SQ, P, X->limp[B->first + k], root, V );
+        release_info( P );
       }
     }
+    pushBatch( &PL.freeQ, B );
   }
+  if( DEDUP_TRANS ) insertStaged( &D, H, root, V );
+
+  pthread_join( reader, NULL );
+  for( i=0; i < workers; i++ )
+    pthread_join( worker[i], NULL );
+  for( i=0; i < nPool; i++ ){
+    for( k=0; k < PIPE_BATCH; k++ ){
+      free( pool[i].raw[k].item );
+      free( pool[i].raw[k].weight );
+    }
+    free( pool[i].items );
+    free( pool[i].keys );
+  }
+  destroyQueue( &PL.freeQ );
+  destroyQueue( &PL.workQ );
+  destroyQueue( &PL.doneQ );
+  free( pool );
+  free( pending );
+  free( worker );
+  free( S );
 }
 
-void countFreq( TreeNode *leaf, Counter *c, int count ){
-  TreeNode *X;
+/* ======================================================================= */
 
-  X = leaf;
-  while( (X != NULL) && (X->item != ROOT) ){
-    c->cnt[X->item] += count;
-    X = X->parent;
-  }
-}
+/*
+  Partitioned mining (-P parts). The coordinator deals the top-level
+  header positions round robin to parts worker processes. Each worker
+  reads the database itself, inserts only the transactions holding one
+  of its items, cut after the last of them (the branches of its items
+  only see the path above them), and mines only its branches. The
+  candidates come back over a pipe; the coordinator checks that each
+  one belongs to the branch of the worker that sent it, that every
+  stream is complete and every worker exited cleanly, and then filters
+  the merged set. Each worker has its own address space and its own
+  memory budget (-m).
+
+  Stream: per candidate the item count, the items, climp, dgimp, an
+  info flag and the info (as spillInfo writes it); then -1 and the
+  number of candidates sent.
+*/
 
-void getRevList( Counter *c, TreeNode *N, shortList *list, int minSig ){
-  TreeNode *X;
+void mineWorker( const char *dbFile, ScanCtx *X, Header *H, int part, int parts, int workers, FILE *out ){
+  char partItem[MAXITEMS+1], mask[MAXITEMS+1];
+  TransReader R;
+  TreeNode *root;
+  shortList nullList;
+  FILE *fp;
+  int h, i, n, numTrans, hasInfo;
 
-  list->size = 0;
-  X = N;
-  while( X != NULL ){
-    if( (c->cnt[X->item] >= minSig) && (X->item != ROOT) ){
-      (list->size)++;
-      list->datum1[list->size] = X->item;
-      list->key[list->size] = X->count;
+  for( i=1; i <= MAXITEMS; i++ ){
+    partItem[i] = FALSE;
+    mask[i] = FALSE;
+  }
+  for( h=1; h <= MIN(H->hdrLen, MAXITEMS); h++ )
+    if( h % parts == part ){
+      mask[h] = TRUE;
+      partItem[H->item[h]] = TRUE;
     }
-    X = X->parent;
+
+  if( (fp = fopen( dbFile, "r" )) == NULL ){
+    fprintf( stderr, "ERROR[mineWorker]: Can't open %s\n", dbFile );
+    exit( 0 );
+  }
+  openReader( &R, fp );
+  readInt( &R, &numTrans );
+  X->part = partItem;
+  initPairs( H );
+  root = createNewNode( ROOT, 1 );
+  insertTransactions( &R, numTrans, X, H, root, NULL, workers );
+  closeReader( &R );
+  fclose( fp );
+  if( compactTrees )
+    root = compactTree( H, root, 0 );
+
+  growFloor = (part == 0 ? parts : part);
+  growOnly = mask;
+  nullList.size = 0;
+  FPgrowth( H, root, &nullList, countMem(0,H), X->minClimp );
+  growOnly = NULL;
+  growFloor = 1;
+  freeTree( root, H );
+  freePairs( H );
+  mineSpilled( X->minClimp );
+  freeFrames();
+
+  for( i = 0; i < sizeFP; i ++ ){
+    spillWrite( out, &FP[i].len, sizeof(int) );
+    spillWrite( out, FP_ITEMS( &FP[i] ), FP[i].len * sizeof(int) );
+    spillWrite( out, &FP[i].climp, sizeof(weight_t) );
+    spillWrite( out, &FP[i].dgimp, sizeof(weight_t) );
+    hasInfo = (FP[i].info != NULL);
+    spillWrite( out, &hasInfo, sizeof(int) );
+    if( hasInfo )
+      spillInfo( out, FP[i].info );
   }
+  n = -1;
+  spillWrite( out, &n, sizeof(int) );
+  spillWrite( out, &sizeFP, sizeof(int) );
 }
 
-void freeTree( TreeNode *tree, Header *hdr ){
-  int i;
-  TreeNode *head, *temp;
+/* appends the candidates of worker part to FP */
+void readPartition( FILE *in, Header *H, int part, int parts ){
+  Itemset *I;
+  int i, n, item, low, got = 0, hasInfo;
 
-  for( i=1; i <= hdr->hdrLen; i++ ){
-    head = hdr->head[i];
-    while( head != NULL ){
-      temp = head;
-      head = head->nodeLink;
-      if(temp->info != NULL){
-      	//free(temp->info); //how to free the info?
+  while( TRUE ){
+    if( ! spillRead( in, &n, sizeof(int) ) ){
+      fprintf( stderr, "ERROR[readPartition]: Worker %d stopped early\n", part );
+      exit( 0 );
+    }
+    if( n < 0 ) break;
+    I = openFP();
+    for( i = 0, low = 0; i < n; i ++ ){
+      if( ! spillRead( in, &item, sizeof(int) ) || item < 1 || item > MAXITEMS || H->mapHdr[item] == 0 ){
+        fprintf( stderr, "ERROR[readPartition]: Bad item from worker %d\n", part );
+        exit( 0 );
       }
-      free( temp );
+      add_item( I, item );
+      low = MAX( low, H->mapHdr[item] );
+    }
+    // the lowest ranked item names the branch the group was found in
+    if( n == 0 || low % parts != part ){
+      fprintf( stderr, "ERROR[readPartition]: Worker %d sent a group of another partition\n", part );
+      exit( 0 );
     }
+    if( ! spillRead( in, &I->climp, sizeof(weight_t) ) || ! spillRead( in, &I->dgimp, sizeof(weight_t) ) ||
+        ! spillRead( in, &hasInfo, sizeof(int) ) ){
+      fprintf( stderr, "ERROR[readPartition]: Worker %d stopped early\n", part );
+      exit( 0 );
+    }
+    if( hasInfo )
+      I->info = readInfo( in );
+    closeFP( I );
+    got ++;
+  }
+  if( ! spillRead( in, &n, sizeof(int) ) || n != got ){
+    fprintf( stderr, "ERROR[readPartition]: Worker %d sent %d of %d groups\n", part, got, n );
+    exit( 0 );
   }
-  free( tree );
 }
 
-void FPgrowth( Header *H, TreeNode *tree, shortList *alpha, int memSpc, int minSig){
-  int h, i, k;
-  Counter c;
-  TreeNode *leaf;
-  shortList list, RList;
-  Header LH;
-  TreeNode *bTree;
-  shortList alpha2;
-  longList Q;
-
-  if( SING_PATH && isSinglePath(tree) ){
-    /* SINGLE-PATH TREE: extract items into a list in top-down fashion */
-    if( DEBUG ) printf( "single path\n" );
-    pathToListTD( tree, &list );		// COPY THE PATH TO THE LIST
-    if( DEBUG ) showSList( &list );
-    mine( &list, alpha );				// MINE THE ITEMS IN THE LIST
-  }else{
-	  // IF NOT SINGLE PATH TREE I.E. MULTI-PART TREE
-    if( DEBUG ) printf( "multi path\n" );
-    // printf("[%d]", H->hdrLen);
-    for( h = H->hdrLen; h >= 1; h-- ){
-	      if( DEBUG ) printf( "multi path: %d\n", H->item[h] );
-	      /* NOTE: H->head[h]->item == H->item[h] */
-
-	      leaf = H->head[h];
-	      for( i=1; i <= MAXITEMS; i++ )
-			c.cnt[i] = 0;
-	      while( leaf != NULL ){
-			// CALC THE FREQ OF THE NODES IN THE CURRENT PATH
-			countFreq( leaf, &c, leaf->count );
-			leaf = leaf->nodeLink;
-	      }
-
-	      //if( CNT_CCC ){
-		/* Upper bound: numSupCnt += H->hdrLen; */
-		/* Reasonable bound (impl): numSupCnt += h; */
-		/* Tighter bound: */
-			//for( i=1; i < h; i++ )
-				//if( c.cnt[H->item[i]] > 0 ) numSupCnt++;
-	      //}
-		#if CNT_FP
-	      (countL[MIN(1 + alpha->size,MAXLEVEL)])++;
-	    #endif
-//here print out the frequent patterns
-		  if( PRT_FP ){
-			if( c.cnt[H->item[h]] >= minSig ){
-			  showFP( H->item[h], alpha, c.cnt[H->item[h]], H->head[h] );
-			  storeFP( H->item[h], alpha, c.cnt[H->item[h]], H->head[h] );
-			  if(PRT_FALSE_POS){
-			  	initial_number ++;
-			  }
-			}
-	      }
-
-	      if( SORT_TREE ){	// WHY??
-			Q.size = 0;
-			for( i=1; i < h; i++ )
-			  if( c.cnt[H->item[i]] >= minSig ){
-				insMinUQ( &Q, c.cnt[H->item[i]], H->item[i] );
-			  }
-			heapSortDescUQ( &Q );
-			if( DEBUG ) showHeapUQ( &Q );
-
-			cleanHdr( &LH );		// CREATE THE HEADER OF PROJECTED-DB
-			for( i=1; i <= Q.size; i++ )
-			  insertHdr( &LH, Q.datum1[i], 0 ); //CHANGE THIS 0
-		  }else{ /* NO SORT_TREE */
-			cleanHdr( &LH );
-			for( i=1; i < h; i++ )
-			  if( c.cnt[H->item[i]] >= minSig )
-				insertHdr( &LH, H->item[i] , 0); //CHANGE THIS 0
-	      }
-		if(LH.hdrLen <= 0){
-			leaf = H->head[h];
-			while(leaf != NULL){
-		
-				if(leaf->info != NULL && leaf->parent->info == NULL){
-					PersonalInfo *P = create_info_copy(leaf->info);
-					leaf->parent->info = P;
-				}
-				else if(leaf->parent->info != NULL && leaf->info != NULL){
-					combine_info(leaf->info, leaf->parent->info);
-				}
-				leaf = leaf->nodeLink;
-			}
-		}
-	      if( LH.hdrLen > 0 ){
-			bTree = createNewNode( ROOT, 1 ); // PROJ-TREE ROOT NODE
-			leaf = H->head[h];
-			while( leaf != NULL ){			// BUILD THE PROJ-TREE
-			  if(leaf->info != NULL && leaf->parent->info == NULL){
-				PersonalInfo *P = create_info_copy(leaf->info);
-				leaf->parent->info = P;
-			  }
-			  else if(leaf->parent->info != NULL && leaf->info != NULL){
-				combine_info(leaf->info, leaf->parent->info);
-			  }
-			  getRevList( &c, leaf->parent, &list, minSig );
-			  if( list.size > 0 ){
-				if( SORT_TREE ){
-				  sortList( &list, &RList, &c );
-				  insertTree( &LH, &RList, leaf->info, leaf->count, 1, RList.size, bTree );
-				}else{
-				  insertTreeRev( &LH, &list, leaf->info, leaf->count, 1, list.size, bTree );
-				}
-			  }
-			  leaf = leaf->nodeLink;
-			}
+void minePartitions( const char *dbFile, ScanCtx *X, Header *H, int parts, int workers ){
+  pid_t *pid;
+  FILE **in, *out;
+  int p, fd[2], status;
 
-			if( DEBUG ){
-			  showFullHdr( &LH );
-			  showTree2( bTree );
-			}
-			for( k = alpha->size; k >= 1; k-- ){
-			  alpha2.datum1[k+1] = alpha->datum1[k];
-			  alpha2.key[k+1] = alpha->key[k];
-			}
-			alpha2.datum1[1] = H->item[h];
-			alpha2.key[1] = c.cnt[H->item[h]];
-			alpha2.size = alpha->size + 1;
-			FPgrowth( &LH, bTree, &alpha2, countMem(memSpc,&LH), minSig );
-			freeTree( bTree, &LH );
-	      }
-	  }
+  pid = (pid_t *)malloc( parts * sizeof(pid_t) );
+  in = (FILE **)malloc( parts * sizeof(FILE *) );
+  if( pid == NULL || in == NULL ){
+    fprintf( stderr, "ERROR[minePartitions]\n" );
+    exit( 0 );
   }
-  if( DEBUG ) printf( "FP growth: Completed\n" );
+  fflush( stdout );	// not to be written again by the workers
+  for( p = 0; p < parts; p ++ ){
+    if( pipe( fd ) != 0 || (pid[p] = fork()) < 0 ){
+      fprintf( stderr, "ERROR[minePartitions]: Can't start worker %d\n", p );
+      exit( 0 );
+    }
+    if( pid[p] == 0 ){
+      close( fd[0] );
+      if( (out = fdopen( fd[1], "wb" )) == NULL ) _exit( 1 );
+      echoCandidates = FALSE;
+      mineWorker( dbFile, X, H, p, parts, workers, out );
+      if( fclose( out ) != 0 ) _exit( 1 );
+      _exit( 0 );
+    }
+    close( fd[1] );
+    if( (in[p] = fdopen( fd[0], "rb" )) == NULL ){
+      fprintf( stderr, "ERROR[minePartitions]: Can't read worker %d\n", p );
+      exit( 0 );
+    }
+  }
+  for( p = 0; p < parts; p ++ ){
+    readPartition( in[p], H, p, parts );
+    fclose( in[p] );
+    if( waitpid( pid[p], &status, 0 ) != pid[p] || ! WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ){
+      fprintf( stderr, "ERROR[minePartitions]: Worker %d failed\n", p );
+      exit( 0 );
+    }
+  }
+  free( pid );
+  free( in );
 }
 
 /* ======================================================================= */
 
+const char *orderName[] = { "climp", "freq", "degree", "asc" };
+
 int main( int argc, char *argv[] ){
 
   int items[MAXITEMS+1];
-  int i, j;
+  int i, j, verify, differ;
+  weight_t *scanned;
   FILE *fpOrg, *fpConf, *fpRev;
-  int numTrans, transInd, pid, numItems, item, weight;
-  float conf;
+  OutWriter W;
+  int outFormat, echo;
+  TransReader R;
+  RawTrans RT;
+  ScanCtx X;
+  Vertical V;
+  int workers, parts, edgeInput, numRuns = 0;
+  long numEdges = 0;
+  const char *dbFile;
+  char *golden, *baseline, *saveBaseline, *serverPath;
+  double tolerance;
+  int failed;
+  int numTrans, numItems, item, weight;
+  double conf;
   double minSig;
+  weight_t minClimp;
   int sizeDB;
-  double weight_DB = 0;
+  weight_t weight_DB = 0;
   longList Q;
   TreeNode *root;
   Header H;
   shortList nullList;
-  shortList SQ;
   sizeFP = 0;
   
-  float confidence[MAXITEMS + 1];
-  double limp[MAXTRANSACTIONS + 1];
-  double dlimp_DB = 0;
-  double climp[MAXITEMS + 1];
-  double dgimp[MAXITEMS + 1];
+  weight_t confidence[MAXITEMS + 1];
+  weight_t limp[MAXTRANSACTIONS + 1];
+  weight_t dlimp_DB = 0;
+  weight_t climp[MAXITEMS + 1];
+  weight_t dgimp[MAXITEMS + 1];
+  int present[MAXITEMS + 1];
+  weight_t freq[MAXITEMS + 1];
+  weight_t order[MAXITEMS + 1];
+  uint64_t *adj = NULL;
+  int distinct[MAXITEMS + 1], nd, k;
+  weight_t maxClimp;
+  long globalNodes = 0;
   double sig[MAXITEMS + 1];
 
-  struct timeval  start_time, end_time; /* structs for timer     */
-  struct timezone zone;
-  long int sec = 0, usec = 0; /* sec & microsec for the timer    */
-  
-  long int time_total_sec = 0;
-  double time_total_msec = 0;
-  long int time_total_usec = 0;
-  
   initial_number = 0;
+  allocFP();
+
+#if BENCH_SORT
+  benchSort();
+  return 0;
+#endif
 
-   if( argc != 5 ){
-     fprintf( stderr, "Usage: %s database confidenceTable outFile minSig\n", argv[0] );
+   if( argc < 5 ){
+     fprintf( stderr, "Usage: %s database confidenceTable outFile minSig [-m budgetMB] [-p pseudoNodes] [-M all|closed|maximal] [-s] [-o text|ndjson|binary] [-q] [-t workers] [-T] [-g golden] [-b baseline] [-B baseline] [-r tolerance] [-S socket] [-P parts] [-O climp|freq|degree|asc] [-i] [-c] [-E hybrid|tree|vertical] [-e]\n", argv[0] );
+     exit( 0 );
+   }
+   memBudget = 0;
+   pseudoMax = PSEUDO_NODES;
+   mineMode = MINE_ALL;
+   verify = FALSE;
+   outFormat = OUT_TEXT;
+   echo = TRUE;
+   workers = 0;
+   parts = 1;
+   sortTree = SORT_TREE;
+   hdrOrder = ORDER_CLIMP;
+   compactTrees = FALSE;
+   engine = ENGINE_HYBRID;
+   edgeInput = FALSE;
+   golden = baseline = saveBaseline = serverPath = NULL;
+   tolerance = REGRESS_TOLERANCE;
+   for( i = 5; i < argc; i++ ){
+     if( strcmp( argv[i], "-m" ) == 0 && i + 1 < argc ){
+       memBudget = (long)(atof( argv[++i] ) * 1024 * 1024);
+     }else if( strcmp( argv[i], "-p" ) == 0 && i + 1 < argc ){
+       pseudoMax = atoi( argv[++i] );
+     }else if( strcmp( argv[i], "-M" ) == 0 && i + 1 < argc ){
+       i++;
+       if( strcmp( argv[i], "all" ) == 0 ) mineMode = MINE_ALL;
+       else if( strcmp( argv[i], "closed" ) == 0 ) mineMode = MINE_CLOSED;
+       else if( strcmp( argv[i], "maximal" ) == 0 ) mineMode = MINE_MAXIMAL;
+       else{
+         fprintf( stderr, "ERROR[%s]: Unknown mining mode %s\n", argv[0], argv[i] );
+         exit( 0 );
+       }
+     }else if( strcmp( argv[i], "-s" ) == 0 ){
+       verify = TRUE;
+     }else if( strcmp( argv[i], "-o" ) == 0 && i + 1 < argc ){
+       i++;
+       if( strcmp( argv[i], "text" ) == 0 ) outFormat = OUT_TEXT;
+       else if( strcmp( argv[i], "ndjson" ) == 0 ) outFormat = OUT_NDJSON;
+       else if( strcmp( argv[i], "binary" ) == 0 ) outFormat = OUT_BINARY;
+       else{
+         fprintf( stderr, "ERROR[%s]: Unknown output format %s\n", argv[0], argv[i] );
+         exit( 0 );
+       }
+     }else if( strcmp( argv[i], "-q" ) == 0 ){
+       echo = FALSE;
+     }else if( strcmp( argv[i], "-t" ) == 0 && i + 1 < argc ){
+       workers = atoi( argv[++i] );
+     }else if( strcmp( argv[i], "-T" ) == 0 ){
+       timerDetail = TRUE;
+     }else if( strcmp( argv[i], "-g" ) == 0 && i + 1 < argc ){
+       golden = argv[++i];
+     }else if( strcmp( argv[i], "-b" ) == 0 && i + 1 < argc ){
+       baseline = argv[++i];
+       timerDetail = TRUE;
+     }else if( strcmp( argv[i], "-B" ) == 0 && i + 1 < argc ){
+       saveBaseline = argv[++i];
+       timerDetail = TRUE;
+     }else if( strcmp( argv[i], "-r" ) == 0 && i + 1 < argc ){
+       tolerance = atof( argv[++i] );
+     }else if( strcmp( argv[i], "-S" ) == 0 && i + 1 < argc ){
+       serverPath = argv[++i];
+     }else if( strcmp( argv[i], "-P" ) == 0 && i + 1 < argc ){
+       parts = atoi( argv[++i] );
+     }else if( strcmp( argv[i], "-O" ) == 0 && i + 1 < argc ){
+       i++;
+       if( strcmp( argv[i], "climp" ) == 0 ) hdrOrder = ORDER_CLIMP;
+       else if( strcmp( argv[i], "freq" ) == 0 ) hdrOrder = ORDER_FREQ;
+       else if( strcmp( argv[i], "degree" ) == 0 ) hdrOrder = ORDER_DEGREE;
+       else if( strcmp( argv[i], "asc" ) == 0 ) hdrOrder = ORDER_ASC;
+       else{
+         fprintf( stderr, "ERROR[%s]: Unknown header order %s\n", argv[0], argv[i] );
+         exit( 0 );
+       }
+     }else if( strcmp( argv[i], "-i" ) == 0 ){
+       sortTree = FALSE;
+     }else if( strcmp( argv[i], "-c" ) == 0 ){
+       compactTrees = TRUE;
+     }else if( strcmp( argv[i], "-E" ) == 0 && i + 1 < argc ){
+       i++;
+       if( strcmp( argv[i], "tree" ) == 0 ) engine = ENGINE_TREE;
+       else if( strcmp( argv[i], "vertical" ) == 0 ) engine = ENGINE_VERTICAL;
+       else if( strcmp( argv[i], "hybrid" ) == 0 ) engine = ENGINE_HYBRID;
+       else{
+         fprintf( stderr, "ERROR[%s]: Unknown engine %s\n", argv[0], argv[i] );
+         exit( 0 );
+       }
+     }else if( strcmp( argv[i], "-e" ) == 0 ){
+       edgeInput = TRUE;
+     }else{
+       fprintf( stderr, "ERROR[%s]: Unknown option %s\n", argv[0], argv[i] );
+       exit( 0 );
+     }
+   }
+   if( serverPath != NULL && parts > 1 ){
+     fprintf( stderr, "ERROR[%s]: -S and -P can't be combined\n", argv[0] );
+     exit( 0 );
+   }
+   if( engine == ENGINE_VERTICAL && (serverPath != NULL || parts > 1) ){
+     fprintf( stderr, "ERROR[%s]: -E vertical can't be combined with -S or -P\n", argv[0] );
      exit( 0 );
    }
 
-   fpOrg = fopen( argv[1], "r" );
+   if( edgeInput ){	// grouped into a database of the usual format
+     phaseBegin( "grouping edges" );
+     fpOrg = groupEdges( argv[1], memBudget, &numEdges, &numRuns );
+     phaseEnd();
+     dbFile = edgeDbPath;
+   }else{
+     fpOrg = fopen( argv[1], "r" );
+     dbFile = argv[1];
+   }
    fpConf = fopen(argv[2], "r" );
-   fpRev = fopen( argv[3], "w" );
+   fpRev = fopen( argv[3], outFormat == OUT_BINARY ? "wb" : "w" );
    minSig = atof( argv[4] );
 
    //setTransNum = atoi(argv[4]);	// to change the size of the data set
@@ -1290,6 +4850,11 @@ int main( int argc, char *argv[] ){
     fprintf( stderr, "ERROR[%s]: Can't open %s or %s or %s\n", argv[0], argv[1], argv[2], argv[3] );
     exit( 0 );
   }
+  openWriter( &W, fpRev, outFormat, echo );
+  if( edgeInput ){
+    printf( "[SF-Tree] Grouped %ld edges by source in %d sorted runs\n", numEdges, numRuns );
+    writeNote( &W, "[SF-Tree] Grouped %ld edges by source in %d sorted runs\n", numEdges, numRuns );
+  }
 
   //numConstrChk = 0;
   numSupCnt = 0;
@@ -1301,94 +4866,105 @@ int main( int argc, char *argv[] ){
   for( i = 1; i <= MAXITEMS; i++ ){
     items[i] = 0;
     confidence[i] = 0;
-    climp[i] = -1;
+    climp[i] = 0;
     dgimp[i] = 0;
+    present[i] = 0;
+    freq[i] = 0;
     sig[i] = 0;
   }
   for( i = 1; i <= MAXTRANSACTIONS; i ++){
   	limp[i] = 0;
   }
   
-  //record the time for the first db scan
-  if(gettimeofday(&start_time, &zone) == -1){
-    fprintf(stderr, "gettimeofday error\n");
-  }
+  phaseBegin( "first db scan" );
   
 	fscanf(fpConf, "%d ", &numItems); 
 	for(i = 1; i <= numItems; i ++){
 	
-		fscanf(fpConf, "%d %f ", &item, &conf);
-		confidence[item] = conf;
+		fscanf(fpConf, "%d %lf ", &item, &conf);
+		confidence[item] = DBL_TO_WEIGHT(conf);
+		if(fabs(conf * WEIGHT_SCALE - confidence[item]) > 1e-6 * WEIGHT_SCALE){
+			fprintf(stderr, "WARNING[%s]: Confidence %.10g of item %d rounded to %.4f\n",
+				argv[0], conf, item, WEIGHT_TO_DBL(confidence[item]));
+		}
 	}
 
-  fscanf( fpOrg, "%d ", &numTrans );
+  openReader( &R, fpOrg );
+  if( ! readInt( &R, &numTrans ) || numTrans > MAXTRANSACTIONS ){
+    fprintf( stderr, "ERROR[%s]: Bad transaction count in %s\n", argv[0], argv[1] );
+    exit( 0 );
+  }
   sizeDB = numTrans;
+  infoUniverse = numTrans;
+  RT.cap = 0;
+  RT.item = RT.weight = NULL;
+  //co-occurrence bitmap, one row per item, for the degree order
+  if( hdrOrder == ORDER_DEGREE ){
+    adj = (uint64_t *)calloc( (size_t)(MAXITEMS + 1) * ADJ_WORDS, sizeof(uint64_t) );
+    if( adj == NULL ){
+      fprintf( stderr, "ERROR[%s]: No memory for the degree order\n", argv[0] );
+      exit( 0 );
+    }
+  }
 	for(i = 1; i <= numTrans; i ++){
 	
-		fscanf(fpOrg, "%d ", &pid);
-		fscanf(fpOrg, "%d ", &numItems);
+		readTrans(&R, &RT);
 
-		for(j = 1; j <= numItems; j ++){
-			fscanf(fpOrg, "%d %d ", &item, &weight);
+		nd = 0;
+		for(j = 0; j < RT.n; j ++){
+			item = RT.item[j];
+			weight = RT.weight[j];
 
+			if(adj != NULL && items[item] == 0){
+				distinct[nd ++] = item;
+			}
 			items[item] = 1;
 			limp[i] += (weight * confidence[item]);
 			dgimp[item] += (weight * confidence[item]);
 		}
 		dlimp_DB += limp[i];
+		for(j = 0; j < nd; j ++){
+			for(k = 0; k < nd; k ++){
+				adj[(size_t)distinct[j] * ADJ_WORDS + (distinct[k] >> 6)] |= (uint64_t)1 << (distinct[k] & 63);
+			}
+		}
 		
+		//branch-free over the universe so it vectorizes
 		for(j = 1; j <= MAXITEMS; j ++){
-			if(items[j] == 1){
-				if(climp[j] == -1){
-					climp[j] = 0;
-				}
-				climp[j] += limp[i];
-				items[j] = 0;
-			}
+			climp[j] += limp[i] * items[j];
+			present[j] |= items[j];
+			freq[j] += items[j];
+			items[j] = 0;
 		}
 		weight_DB += limp[i];
 	}
 	
-	if(gettimeofday(&end_time, &zone) == 0){
-      	if(end_time.tv_usec >= start_time.tv_usec){
-      		sec  = end_time.tv_sec - start_time.tv_sec;
-      		usec = end_time.tv_usec - start_time.tv_usec;
-      	}else{
-      		sec  = end_time.tv_sec - start_time.tv_sec - 1;
-      		usec = end_time.tv_usec - start_time.tv_usec + 1000000;
-      	}
-      	time_total_sec += sec;
-      	time_total_usec += usec;
-      	
-      	fprintf(stdout, "\n[SF-Tree] Total runtime for first db scan is %ld sec. %.3f msec\n", sec, usec/1000.0);
-      	fpRev = fopen( argv[3], "a" );
-      	fprintf(fpRev, "\n[SF-Tree] Total runtime for first db scan is %ld sec. %.3f msec\n", sec, usec/1000.0);
-      	fclose( fpRev );
-      }
+	phaseEnd();
       
 	for(i = 1; i <= MAXITEMS; i ++){
-		sig[i] = dgimp[i] / dlimp_DB;
+		sig[i] = (double)dgimp[i] / dlimp_DB;
 	}
+	minClimp = MIN_CLIMP(dlimp_DB, minSig);
 
 	if(DEBUG){
 		printf("\n");
 		for(i = 1; i <= MAXITEMS; i ++){
-			printf("\nitem (%d) has conf: %f", i, confidence[i]);
+			printf("\nitem (%d) has conf: %f", i, WEIGHT_TO_DBL(confidence[i]));
 		}
 		printf("\n");
 		for(i = 1; i <= MAXTRANSACTIONS; i ++){
-			printf("\nL%d has limp: %f", i, limp[i]);
+			printf("\nL%d has limp: %f", i, WEIGHT_TO_DBL(limp[i]));
 		}
 		printf("\n");
-		printf("\nlimp(DB): %f", dlimp_DB);
+		printf("\nlimp(DB): %f", WEIGHT_TO_DBL(dlimp_DB));
 		printf("\n");
 		for(i = 1; i <= MAXITEMS; i ++){
-			printf("\nitem (%d) has climp: %f", i, climp[i]);
+			printf("\nitem (%d) has climp: %f", i, WEIGHT_TO_DBL(climp[i]));
 		
 		}
 		printf("\n");
 		for(i = 1; i <= MAXITEMS; i ++){
-			printf("\nitem (%d) has dgimp: %f", i, dgimp[i]);
+			printf("\nitem (%d) has dgimp: %f", i, WEIGHT_TO_DBL(dgimp[i]));
 		
 		}
 		printf("\n");
@@ -1405,90 +4981,103 @@ int main( int argc, char *argv[] ){
       //if( L1[i] > 0 ){ numConstrChk++; numSupCnt++; }
   //}
 
-  /* sort the valid domain items in descending order of support count */
+  /* sort the valid domain items in the header order (default: descending climp) */
   
+  maxClimp = 0;
+  for( i = 1; i <= MAXITEMS; i++ ){
+    maxClimp = MAX( maxClimp, climp[i] );
+  }
+  for( i = 1; i <= MAXITEMS; i++ ){
+    if( hdrOrder == ORDER_FREQ ){
+      order[i] = freq[i];
+    }else if( hdrOrder == ORDER_DEGREE ){
+      //neighbours that make it into the tree
+      order[i] = 0;
+      for( j = 1; j <= MAXITEMS; j++ )
+        if( j != i && present[j] && climp[j] >= minClimp &&
+            ((adj[(size_t)i * ADJ_WORDS + (j >> 6)] >> (j & 63)) & 1) )
+          order[i]++;
+    }else if( hdrOrder == ORDER_ASC ){
+      order[i] = maxClimp - climp[i];	// keys of the sort are not negative
+    }else{
+      order[i] = climp[i];
+    }
+  }
+  free( adj );
+
   Q.size = 0;
   for( i = 1; i <= MAXITEMS; i++ ){
 
-    if(climp[i] >= MIN_CLIMP(dlimp_DB, minSig)){
-      insMinUQ(&Q, climp[i], i);
+    if(present[i] && climp[i] >= minClimp){
+      appendUQ(&Q, order[i], i);
     }
   }
     
-  heapSortDescUQ( &Q );
+  sortDescUQ( &Q );
   if( DEBUG ) showHeapUQ( &Q );
 
-  cleanHdr( &H );
+  initHdr( &H );
   for( i=1; i <= Q.size; i++ )
     insertHdr( &H, Q.datum1[i], Q.key[i]);
 
   if( DEBUG ) showHdr( &H );
  
+  X.climp = climp;
+  X.confidence = confidence;
+  X.limp = limp;
+  X.order = order;
+  X.minClimp = minClimp;
+  X.part = NULL;
+
   //printf("msg1a\n");
-  if( H.hdrLen > 0 ){ 
+  if( H.hdrLen > 0 && parts > 1 ){
+    phaseBegin( "partitioned mining" );
+    minePartitions( dbFile, &X, &H, parts, workers );
+    filterFP();
+    phaseEnd();
+  }else if( H.hdrLen > 0 && engine == ENGINE_VERTICAL ){
+    rewindReader( &R );
+    readInt( &R, &numTrans );
+
+    phaseBegin( "creating bitmaps" );
+    initVertical( &V );
+    insertTransactions( &R, numTrans, &X, &H, NULL, &V, workers );
+    buildVertical( &V, H.hdrLen );
+    phaseEnd();
+    printf( "\n[SF-Tree] Vertical engine: %d rows over %d items\n", V.nRows, H.hdrLen );
+    writeNote( &W, "\n[SF-Tree] Vertical engine: %d rows over %d items\n", V.nRows, H.hdrLen );
+
+    phaseBegin( "vertical mining" );
+    nullList.size = 0;
+    vertMine( &V, &H, &nullList, minClimp );
+    freeVertical( &V );
+    filterFP();
+    phaseEnd();
+  }else if( H.hdrLen > 0 ){ 
     root = createNewNode( ROOT, 1 );
 
-    rewind( fpOrg );
-    fscanf( fpOrg, "%d ", &numTrans );
+    rewindReader( &R );
+    readInt( &R, &numTrans );
 
-    //record the time for creating the tree
-    if(gettimeofday(&start_time, &zone) == -1){
-    	 fprintf(stderr, "gettimeofday error\n");
-    }
+    phaseBegin( "creating tree" );
     
-    for( transInd = 1; transInd <= numTrans; transInd++ ){
-
-      SQ.size = 0;
-      fscanf( fpOrg, "%d ", &pid );
-      fscanf( fpOrg, "%d ", &numItems );
-      for( i = 1; i <= numItems; i++ ){
-		fscanf( fpOrg, "%d %d ", &item, &weight );
-		
-		if(climp[item] < MIN_CLIMP(dlimp_DB, minSig)){
-			
-			limp[transInd] -= (weight * confidence[item]);
-		}
-		items[item] = 1;
-		
-      }
-      //insert each transaction one by one into the tree ie. insert L1 then L2, then L3 separately
-      for(i = 1; i <= MAXITEMS; i ++){
-      	if(items[i] == 1){
-      		if(climp[i] >= MIN_CLIMP(dlimp_DB, minSig)){
-      		
-				insMinUList( &SQ, climp[i], i ); 
-			}
-			items[i] = 0;
-      	}
-      }
-      heapSortDescUList( &SQ );
-
-     // if( DEBUG ) showHeapUList( &SQ );
-     PersonalInfo *P = create_info(transInd);
-      insertTree( &H, &SQ, P, limp[transInd], 1, SQ.size, root );
-    }
+    initPairs( &H );
+    insertTransactions( &R, numTrans, &X, &H, root, NULL, workers );
     
-    	if(gettimeofday(&end_time, &zone) == 0){
-	 	if(end_time.tv_usec >= start_time.tv_usec){
-	 		sec  = end_time.tv_sec - start_time.tv_sec;
-	 		usec = end_time.tv_usec - start_time.tv_usec;
-	 	}else{
-	 		sec  = end_time.tv_sec - start_time.tv_sec - 1;
-	 		usec = end_time.tv_usec - start_time.tv_usec + 1000000;
-	 	}
-	 	time_total_sec += sec;
-      	time_total_usec += usec;
-      	
-	 	fprintf(stdout, "\n[SF-Tree] Total runtime for creating tree is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fpRev = fopen( argv[3], "a" );
-	 	fprintf(fpRev, "\n[SF-Tree] Total runtime for creating tree is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fclose( fpRev );
- 	}
+    	phaseEnd();
+    for( i = 1; i <= H.hdrLen; i++ )
+      globalNodes += H.nodeCnt[i];
+    if( compactTrees )
+      root = compactTree( &H, root, 0 );
+    printf( "\n[SF-Tree] Header order %s: %d items, %ld nodes in the global tree\n",
+	    orderName[hdrOrder], H.hdrLen, globalNodes );
+    writeNote( &W, "\n[SF-Tree] Header order %s: %d items, %ld nodes in the global tree\n",
+	       orderName[hdrOrder], H.hdrLen, globalNodes );
  	
      if(DEBUG){
 		printf("\n");
 		for(i = 1; i <= MAXITEMS; i ++){
-			printf("\nL%d has limp: %f", i, limp[i]);
+			printf("\nL%d has limp: %f", i, WEIGHT_TO_DBL(limp[i]));
 	
 		}
 	}
@@ -1505,30 +5094,33 @@ int main( int argc, char *argv[] ){
 
 	nullList.size = 0;
 	
-	//record the time for the FP-Growth
-	if(gettimeofday(&start_time, &zone) == -1){
-		fprintf(stderr, "gettimeofday error\n");
-	}
-	
-	FPgrowth( &H, root, &nullList, countMem(0,&H), MIN_CLIMP(dlimp_DB, minSig) );
+	if( serverPath != NULL ){
+	  phaseBegin( "serving" );
+	  serveQueries( serverPath, &H, root, dlimp_DB, minSig );
+	  freeTree( root, &H );
+	  phaseEnd();
+	}else{
+	phaseBegin( "FP-Growth" );
 	
-	if(gettimeofday(&end_time, &zone) == 0){
-	 	if(end_time.tv_usec >= start_time.tv_usec){
-	 		sec  = end_time.tv_sec - start_time.tv_sec;
-	 		usec = end_time.tv_usec - start_time.tv_usec;
-	 	}else{
-	 		sec  = end_time.tv_sec - start_time.tv_sec - 1;
-	 		usec = end_time.tv_usec - start_time.tv_usec + 1000000;
-	 	}
-      	time_total_sec += sec;
-      	time_total_usec += usec;
-      	
-	 	fprintf(stdout, "\n[SF-Tree] Total runtime for FP-Growth is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fpRev = fopen( argv[3], "a" );
-	 	fprintf(fpRev, "\n[SF-Tree] Total runtime for FP-Growth is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fclose( fpRev );
- 	}
+	FPgrowth( &H, root, &nullList, countMem(0,&H), minClimp );
 	freeTree( root, &H );
+	mineSpilled( minClimp );
+	freeFrames();
+	filterFP();
+	
+	phaseEnd();
+	printf( "\n[SF-Tree] %ld nodes in the projected trees (%s)\n",
+		nodesMade - globalNodes - 1, sortTree ? "conditional climp order" : "parent order" );
+	writeNote( &W, "\n[SF-Tree] %ld nodes in the projected trees (%s)\n",
+		   nodesMade - globalNodes - 1, sortTree ? "conditional climp order" : "parent order" );
+	printf( "\n[SF-Tree] Conditional bases: %ld trees, %ld in place, %ld bitmaps, %ld spilled\n",
+		basesBy[BASE_TREE], basesBy[BASE_PSEUDO], basesBy[BASE_BITMAP], basesBy[BASE_SPILL] );
+	writeNote( &W, "\n[SF-Tree] Conditional bases: %ld trees, %ld in place, %ld bitmaps, %ld spilled\n",
+		   basesBy[BASE_TREE], basesBy[BASE_PSEUDO], basesBy[BASE_BITMAP], basesBy[BASE_SPILL] );
+	}
+	freePairs( &H );
+	if( numSpilled > 0 )
+		printf( "\n[SF-Tree] Spilled %d projected databases (%ld bytes) to disk\n", numSpilled, spillBytes );
   }
 
  // showMem();
@@ -1544,89 +5136,100 @@ int main( int argc, char *argv[] ){
 //	   numNodesGT, numNodesAllT );
 //  }
   
-	//read the db a 3rd time to get strong group of friends
-	rewind(fpOrg);
-	
-	//record the time for the last db scan
-	if(gettimeofday(&start_time, &zone) == -1){
-		fprintf(stderr, "gettimeofday error\n");
+	//dgimp comes out of the tree; -s reads the db a 3rd time to check it
+  if( verify ){
+	rewindReader(&R);
+	scanned = (weight_t *)calloc(sizeFP + 1, sizeof(weight_t));
+	if(scanned == NULL){
+		fprintf(stderr, "ERROR[%s]: No memory for the verification scan\n", argv[0]);
+		exit(0);
 	}
 	
-  	fscanf( fpOrg, "%d ", &numTrans );
+	phaseBegin( "last db scan" );
+	
+  	readInt( &R, &numTrans );
 	for(i = 1; i <= numTrans; i ++){
 	
-		fscanf(fpOrg, "%d %d ", &pid, &numItems);
+		readTrans(&R, &RT);
 		
 		Transaction T;
 		init_transaction(&T);
-		for(j = 1; j <= numItems; j ++){
-			fscanf(fpOrg, "%d %d ", &item, &weight);
-			(T.itemset[item]) += (weight * confidence[item]);
+		for(j = 0; j < RT.n; j ++){
+			(T.itemset[RT.item[j]]) += (RT.weight[j] * confidence[RT.item[j]]);
+		}
+#if ITEM_MASK
+		for(j = 0; j < RT.n; j ++){
+			if(T.itemset[RT.item[j]] != 0){
+				T.mask |= ITEM_BIT(RT.item[j]);
+			}
 		}
+#endif
 		for(j = 0; j < sizeFP; j ++){
-			if(in_transaction(FP[j].items, &T) == true){
-				FP[j].dgimp += get_dgimp(FP[j].items, &T);
+			if(in_transaction(&FP[j], &T) == true){
+				scanned[j] += get_dgimp(&FP[j], &T);
 			}
 		}
 	}
+	differ = 0;
+	for(j = 0; j < sizeFP; j ++){
+		if(scanned[j] != FP[j].dgimp){
+			differ ++;
+		}
+		FP[j].dgimp = scanned[j];
+	}
+	free(scanned);
 	
-	if(gettimeofday(&end_time, &zone) == 0){
-	 	if(end_time.tv_usec >= start_time.tv_usec){
-	 		sec  = end_time.tv_sec - start_time.tv_sec;
-	 		usec = end_time.tv_usec - start_time.tv_usec;
-	 	}else{
-	 		sec  = end_time.tv_sec - start_time.tv_sec - 1;
-	 		usec = end_time.tv_usec - start_time.tv_usec + 1000000;
-	 	}
-     	time_total_sec += sec;
-      	time_total_usec += usec;
-      	
-	 	fprintf(stdout, "\n[SF-Tree] Total runtime for last db scan is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fpRev = fopen( argv[3], "a" );
-	 	fprintf(fpRev, "\n[SF-Tree] Total runtime for last db scan is %ld sec. %.3f msec\n", sec, usec/1000.0);
-	 	fclose( fpRev );
- 	}
+	phaseEnd();
+	printf("\n[SF-Tree] Verification scan: %d of %d dgimp values differ from the tree\n", differ, sizeFP);
+  }
 	
-  fpRev = fopen( argv[3], "a" );
   if(PRT_FP){
+	phaseBegin( "writing output" );
      
 	printf("\nFound ShFrequent Itemsets:");
-	fprintf(fpRev, "\nFound ShFrequent Itemsets:");
+	writeNote(&W, "\nFound ShFrequent Itemsets:");
 	//printf("\nsig: [%f] weightdb: [%f] dlimpdb: [%f] minclimp: [%f]\n", minSig, weight_DB, dlimp_DB, MIN_CLIMP(dlimp_DB, minSig) );
 	int counter = 0;
 	for(i = 0; i < sizeFP; i ++){
-		double ratio = FP[i].dgimp / weight_DB;
-		//don't round
-		//double sig = (floor(ratio * 100 + 0.5)) / 100;
-		if(ratio >= minSig){
-			print_itemset(&FP[i], fpRev);
+		//compare in fixed point: dgimp / weight_DB >= minSig
+		if(FP[i].dgimp >= minClimp){
+			writeItemset(&W, &FP[i], dlimp_DB);
 			//printf(" climp [%d] dgimp [%f] str [%f]", FP[i].climp, FP[i].dgimp, ratio);
 			counter ++;
 		}
 	}
+	flushWriter(&W);
+	phaseEnd();
 	printf("\n\nFound (%d) ShFrequent Itemsets\n", counter);
 	if(PRT_FALSE_POS){
 		printf("\nFalse Positives: %d\n", initial_number - counter);
   	}
   }
   
-    	time_total_msec = time_total_usec / 1000.0;
-  	if(time_total_msec >= 1000){
-  		time_total_sec += floor(time_total_msec/1000);
-  		time_total_msec = time_total_usec % 1000;
-  	}
-  	
-  	//printf("\ntime sec: %ld time msec: %.3lf time usec: %ld", time_total_sec, time_total_msec, time_total_usec);
-
-	fprintf(stdout, "\n[SF-Tree] Total (aggregate) runtime is %ld sec. %.3lf msec\n", time_total_sec, time_total_msec);
-	fprintf(fpRev, "\n[SF-Tree] Total (aggregate) runtime is %ld sec. %.3lf msec\n", time_total_sec, time_total_msec);
-
+  phaseReport( &W );
+
+  failed = 0;
+  if( golden != NULL )
+    failed += checkGolden( golden, minClimp );
+  if( saveBaseline != NULL )
+    failed += writeBaseline( saveBaseline );
+  if( baseline != NULL )
+    failed += checkBaseline( baseline, tolerance );
+
+  closeWriter(&W);
+  closeReader(&R);
+  free(RT.item);
+  free(RT.weight);
   fclose(fpOrg);
   fclose(fpConf);
   fclose(fpRev);
+  for(i = 0; i < sizeFP; i ++){
+	release_info(FP[i].info);
+  }
+  freeFP();
   printf( "\n===== %s %s %s %f: Completed =====\n\n", argv[0], argv[1], argv[2], minSig );
 
-  return 0;
+  return failed ? 1 : 0;
 }
 
 /* ======================================================================= */
@@ -14,14 +14,39 @@
 #ifndef _FPGROWTH_H
 #define _FPGROWTH_H
 
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
 #define MAXLEVEL       	10
+/* the limits can also be set with -D, as test/run.sh does */
+#ifndef MAXITEMS
 #define MAXITEMS     	10 /* 100, 1000, 10000 */
+#endif
 #define MAXQITEM     	10000 /* 100, 1000, 10000 */
 #define MAXLISTITEMS  	100 /* 64 */
+#ifndef MAXTRANSACTIONS
 #define MAXTRANSACTIONS 	20
+#endif
+#ifndef MAXITEMSETS
 #define MAXITEMSETS  	5000
+#endif
 #define ROOT            	0
 
+#define MINE_ALL		0	/* every candidate itemset */
+#define MINE_CLOSED		1	/* no superset with the same climp */
+#define MINE_MAXIMAL		2	/* significant, no significant superset */
+
+#define ORDER_CLIMP		0	/* global header by descending climp */
+#define ORDER_FREQ		1	/* by descending number of transactions */
+#define ORDER_DEGREE		2	/* by descending number of co-occurring items */
+#define ORDER_ASC		3	/* by ascending climp */
+#define ADJ_WORDS		((MAXITEMS >> 6) + 1)
+
+#define ENGINE_TREE		0	/* FPgrowth over the SF-tree */
+#define ENGINE_VERTICAL		1	/* transaction bitmaps per header item */
+#define ENGINE_HYBRID		2	/* FPgrowth choosing per conditional base */
+
 #define TRUE      		1
 #define FALSE     		0
 #define INVALID 		-10
@@ -33,32 +58,93 @@
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 #define MAX(x,y) ((x) >= (y) ? (x) : (y))
 
-#define MIN_CLIMP(x,y) ((x)*(y))
+/*
+  Weights are kept in fixed point: one unit is 1/WEIGHT_SCALE of
+  (weight * confidence). Confidences are rounded to 1/WEIGHT_SCALE (4
+  decimals) when read, with a warning for any that needs more; after
+  that every product and every sum of products is exact.
+*/
+typedef int64_t weight_t;
+
+#define WEIGHT_SCALE	10000
+#define WEIGHT_TO_DBL(w) ((double)(w) / WEIGHT_SCALE)
+#define DBL_TO_WEIGHT(d) ((weight_t)llround((d) * WEIGHT_SCALE))
+
+/* smallest weight that reaches the fraction y of x (absorbs FP noise of y) */
+#define MIN_CLIMP(x,y) ((weight_t)ceil((double)(x)*(y) - 1e-6))
 
 typedef enum BOOL{
 	false = 0,
 	true = 1
 } boolean;
 
+/* set of transactions (users): sorted tids, or a bitmap when words != NULL */
 typedef struct{
-	int friends[MAXITEMS + 1];
-	//int friends;
+	int refs;
+	int size;		/* transactions in the set */
+	int cap;		/* capacity of tids */
+	int *tids;
+	uint64_t *words;
 } PersonalInfo;
 
+/*
+  Universes of at most 64 (128) items also keep each itemset as a bit
+  mask, bit i-1 for item i, chosen at compile time from MAXITEMS: subset
+  tests are one AND and the items are visited with ctz instead of a scan
+  over the universe. Larger universes only have the items[] arrays.
+*/
+#if MAXITEMS <= 64
+#define ITEM_MASK	1
+typedef uint64_t itemmask_t;
+#elif MAXITEMS <= 128 && defined(__SIZEOF_INT128__)
+#define ITEM_MASK	1
+typedef unsigned __int128 itemmask_t;
+#else
+#define ITEM_MASK	0
+#endif
+
+/*
+  A stored pattern. Its items, ascending, are the len ints at off in
+  the pattern arena (fpItems), so it costs its length, not the universe.
+*/
 typedef struct{
-	int items[MAXITEMS + 1];
-	int climp;
-	double dgimp;
+	long off;	/* first item in the arena */
+	int len;
+#if ITEM_MASK
+	itemmask_t mask;
+#endif
+	weight_t climp;
+	weight_t dgimp;
 	PersonalInfo *info;
 } Itemset;
 
+/* indexes in FP, ascending: the patterns of one item or climp bucket */
 typedef struct{
-	double itemset[MAXITEMS + 1]; //stores the support of each item ie. support of item X = itemset[X]
+	int size;
+	int cap;
+	int *fp;
+} FPList;
+
+typedef struct{
+	weight_t itemset[MAXITEMS + 1]; //stores the support of each item ie. support of item X = itemset[X]
+#if ITEM_MASK
+	itemmask_t mask;	/* items with a nonzero weight */
+#endif
 } Transaction;
 
 typedef struct tN{
   int item;
-  int count;
+  int depth;		/* root = 0 */
+  weight_t count;
+  /*
+    For the transactions accounted at this node (those ending here, plus
+    those of the children once they have been mined): the weight of the
+    prefix the tree is conditioned on, the weight of each path item
+    (wv[d-1] for the item at depth d) and the sum of both.
+  */
+  weight_t aw;
+  weight_t *wv;
+  weight_t bound;
   PersonalInfo *info;
   struct tN *parent;
   struct tN *firstChild;
@@ -70,63 +156,276 @@ typedef struct tN{
 typedef struct{
   int hdrLen;
   int item[MAXITEMS+1];
-  int lgwt[MAXITEMS+1];	//added this, may not actually need it
+  weight_t lgwt[MAXITEMS+1];	//added this, may not actually need it
   int nodeCnt[MAXITEMS+1];
   TreeNode *head[MAXITEMS+1];
   TreeNode *tail[MAXITEMS+1];
   int mapHdr[MAXITEMS+1];
+  TreeNode *block;		/* nodes of a compacted tree, root first */
+  int blockLen;
+  weight_t *pair;		/* pair counts of the tree (see initPairs) */
+  long pairCap;
+  int pairs;			/* pair holds the counts of the current tree */
+  long cells;			/* items of the paths inserted, shared or not */
 } Header;
 
 typedef struct{
   int size;
-  int key[MAXITEMS+1];
+  weight_t key[MAXITEMS+1];
   int datum1[MAXITEMS+1];
 } longList;
 
 typedef struct{
   int size;
-  int key[MAXITEMS+1];
+  weight_t key[MAXITEMS+1];
   int datum0[MAXITEMS+1];
   int datum1[MAXITEMS+1];
 } longBList;
 
 typedef struct{
   int size;
-  int key[MAXLISTITEMS+1];
+  weight_t key[MAXLISTITEMS+1];
   int datum1[MAXLISTITEMS+1]; //stores FP
 } shortList;
 
 typedef struct{
   int size;
-  int key[MAXLISTITEMS+1];
+  weight_t key[MAXLISTITEMS+1];
   int datum0[MAXLISTITEMS+1];
   int datum1[MAXLISTITEMS+1];
 } shortBList;
 
 typedef struct{
-  int cnt[MAXITEMS+1];
+  weight_t cnt[MAXITEMS+1];
 } Counter;
 
+/* reference to a conditional path inside a parent tree */
+typedef struct{
+  TreeNode *node;		/* path continues upward from here */
+  weight_t count;
+  weight_t bound;
+  weight_t aw;			/* prefix weight of the path */
+  weight_t *wv;			/* item weights by depth along the path */
+  PersonalInfo *info;
+} PathRef;
+
+/* conditional pattern base written to disk when over the memory budget */
+typedef struct sP{
+  FILE *fp;			/* spill file it is in */
+  long offset, end;		/* byte range in fp */
+  shortList alpha;		/* prefix the base is conditioned on */
+  struct sP *next;
+} SpillPart;
+
+#define OUT_TEXT		0
+#define OUT_NDJSON		1
+#define OUT_BINARY		2
+#define OUT_BUF_SIZE		(1 << 16)
+
+typedef struct{
+  FILE *fp;
+  char *buf;
+  size_t len;
+} OutBuf;
+
+/* output file in one format, plus optional text echo to stdout */
+typedef struct{
+  int format;
+  int echo;
+  OutBuf file;
+  OutBuf out;
+} OutWriter;
+
+#define READ_BUF_SIZE		(1 << 16)
+#define PIPE_BATCH		256	/* transactions per pipeline batch */
+
+typedef struct{
+  FILE *fp;
+  char *buf;
+  size_t pos, len;
+} TransReader;
+
+/* one transaction as read: item/weight pairs, duplicates included */
+typedef struct{
+  int pid;
+  int n;
+  int cap;
+  int *item;
+  int *weight;
+} RawTrans;
+
+#define EDGE_RUN		(1 << 20)	/* edges per sorted run without -m */
+
+/* edge of an edge-list database (-e): src is the transaction, dst the item */
+typedef struct{
+  int src;
+  int dst;
+  int weight;
+} Edge;
+
+/* sorted run of edges, in a temp file or (the only run) in memory */
+typedef struct{
+  FILE *fp;
+  Edge *mem;
+  long pos, n;
+  Edge head;		/* next edge of the run */
+} EdgeRun;
+
+/* first-pass results the second pass filters and sorts with */
+typedef struct{
+  weight_t *climp;
+  weight_t *confidence;
+  weight_t *limp;
+  weight_t *order;		/* sort key of the items, as in the header */
+  weight_t minClimp;
+  char *part;			/* items of this partition, NULL = all */
+} ScanCtx;
+
+/* per-thread scratch of prepareTrans */
+typedef struct{
+  shortList SQ;
+  weight_t tw[MAXITEMS+1];
+  int seen[MAXITEMS+1];
+  int stamp;
+} PrepScratch;
+
+typedef struct{
+  int seq;			/* position in the input, in batches */
+  int first;			/* transaction number of raw[0] */
+  int n;			/* transactions; 0 marks the end of the input */
+  RawTrans raw[PIPE_BATCH];
+  int start[PIPE_BATCH+1];	/* list k is items/keys[start[k] .. start[k+1]-1] */
+  int cap;
+  int *items;
+  weight_t *keys;
+} TransBatch;
+
+typedef struct{
+  TransBatch **slot;
+  int cap, head, count, closed;
+  pthread_mutex_t mu;
+  pthread_cond_t notEmpty, notFull;
+} BatchQueue;
+
+typedef struct{
+  TransReader *R;
+  int numTrans;
+  ScanCtx *X;
+  BatchQueue freeQ, workQ, doneQ;
+} Pipeline;
+
+/* distinct filtered transaction staged for insertion */
+typedef struct{
+  uint64_t hash;
+  int n;
+  int *items;			/* in header order */
+  weight_t *keys;		/* summed weights of the items */
+  weight_t count;		/* summed limp */
+  PersonalInfo *info;		/* the transactions with this list */
+} DedupEntry;
+
+typedef struct{
+  int size, cap;		/* entries, in the order first seen */
+  DedupEntry *entry;
+  int mask;			/* slots - 1 */
+  int *slot;			/* entry + 1, 0 = empty */
+  int merged;			/* transactions added to an entry */
+} DedupTable;
+
+#define MAX_PHASES		64
+#define MAX_PHASE_DEPTH		64
+
+/* a timed phase; times in seconds */
+typedef struct{
+  char name[32];
+  int parent;			/* enclosing phase, -1 at the top */
+  long calls;
+  double wall, cpu;
+  long rssKB;			/* peak RSS seen at the end of the phase */
+  double start, cpuStart;
+} Phase;
+
+#define GROUP_KEY_MAX		4096	/* text of one group in a golden check */
+#define GOLDEN_SHOW		20	/* differences printed by checkGolden */
+#define REGRESS_TOLERANCE	25.0	/* percent over the baseline */
+#define REGRESS_SLACK_SEC	0.005	/* absorbs jitter of short phases */
+#define REGRESS_SLACK_KB	1024
+
+/* resident tree of the server and its connection count */
+typedef struct{
+  Header *H;
+  TreeNode *root;
+  weight_t dlimpDB;
+  double minSig;		/* the tree holds the items reaching it */
+  int listenFd;
+  int active;			/* connections being served */
+  int stop;
+  pthread_mutex_t mu;
+  pthread_cond_t idle;
+} Server;
+
+typedef struct{
+  Server *S;
+  int fd;
+} ServerConn;
+
+/*
+  Vertical layout of the filtered transactions (rows) over the positions
+  of a header. Rows are staged as lists, then buildVertical turns them
+  into one bitmap per position and the cumulative weights of each row.
+*/
+typedef struct{
+  int nRows, cap;
+  int hdrLen;
+  int words;			/* 64-bit words per bitmap */
+  weight_t *count;		/* limp of each row */
+  weight_t *pw;			/* prefix weight of each row (aw, then the pattern) */
+  PersonalInfo **info;
+  int *tid;			/* the transaction of a row with one, else 0 */
+  int *start;			/* staged row r is item/key[start[r] .. start[r+1]-1] */
+  int *item;			/* header positions */
+  weight_t *key;
+  int itemLen, itemCap;
+  uint64_t *bits;		/* bits[(k-1)*words ...]: rows with position k */
+  weight_t *cum;		/* cum[k*nRows + r]: weight of positions 1..k in row r */
+  uint64_t *scratch;		/* one bitmap per pattern length */
+  uint64_t *mark;		/* transactions of a pattern, INFO_WORDS long */
+} Vertical;
+
+/* per-depth scratch of FPgrowth and pseudoGrowth */
+typedef struct{
+  Counter c, b, w;
+  Header LH;
+  longList Q;
+  shortList list, RList, alpha2;
+} GrowFrame;
+
 void heapifyMaxUQ( longList *A, int i );
-int extractMaxUQ( longList *A, int *datum1 );
-void insMaxUQ( longList *A, int keyVal, int datum1 );
+weight_t extractMaxUQ( longList *A, int *datum1 );
+void insMaxUQ( longList *A, weight_t keyVal, int datum1 );
 void heapifyMinUQ( longList *A, int i );
-int extractMinUQ( longList *A, int *datum1 );
-void insMinUQ( longList *A, int keyVal, int datum1 );
+weight_t extractMinUQ( longList *A, int *datum1 );
+void insMinUQ( longList *A, weight_t keyVal, int datum1 );
 void heapSortAscUQ( longList *A );
 void heapSortDescUQ( longList *A );
 void showHeapUQ( longList *A );
 void showList( longList *A );
 
 void heapifyMaxUList( shortList *A, int i );
-int extractMaxUList( shortList *A, int *datum1 );
-void insMaxUList( shortList *A, int keyVal, int datum1 );
+weight_t extractMaxUList( shortList *A, int *datum1 );
+void insMaxUList( shortList *A, weight_t keyVal, int datum1 );
 void heapifyMinUList( shortList *A, int i );
-int extractMinUList( shortList *A, int *datum1 );
-void insMinUList( shortList *A, int keyVal, int datum1 );
+weight_t extractMinUList( shortList *A, int *datum1 );
+void insMinUList( shortList *A, weight_t keyVal, int datum1 );
 void heapSortAscUList( shortList *A );
 void heapSortDescUList( shortList *A );
 void showHeapUList( shortList *A );
 void showSList( shortList *A );
 
+void sortKeysDesc( weight_t *key, int *datum1, int n );
+void appendUQ( longList *A, weight_t keyVal, int datum1 );
+void sortDescUQ( longList *A );
+void appendUList( shortList *A, weight_t keyVal, int datum1 );
+void sortDescUList( shortList *A );
+
 #endif
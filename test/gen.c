@@ -0,0 +1,82 @@
+/*
+  Dataset generator for the regression suite (test/run.sh).
+
+  To compile: gcc -Wall -O2 gen.c -o gen
+
+  gen users items maxDegree seed database confidenceTable
+
+  Writes users transactions in the SF-Tree input format, each with 1 to
+  maxDegree distinct friends (items 1..items) of weight 1..50, and a
+  confidence table of 0.01..0.99 per item. The generator has its
+  own random numbers (xorshift64*), so a seed gives the same files on
+  every platform and the goldens stay valid.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+uint64_t state;
+
+uint64_t nextRand( void ){
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+/* uniform in lo..hi */
+int randInt( int lo, int hi ){
+  return lo + (int)(nextRand() % (uint64_t)(hi - lo + 1));
+}
+
+int main( int argc, char *argv[] ){
+  FILE *db, *cf;
+  int *pick, users, items, maxDeg, u, i, j, k, t;
+
+  if( argc != 7 ){
+    fprintf( stderr, "Usage: %s users items maxDegree seed database confidenceTable\n", argv[0] );
+    exit( 1 );
+  }
+  users = atoi( argv[1] );
+  items = atoi( argv[2] );
+  maxDeg = atoi( argv[3] );
+  state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)atoll( argv[4] );
+  if( users < 1 || items < 1 || maxDeg < 1 ){
+    fprintf( stderr, "ERROR[%s]: Bad sizes\n", argv[0] );
+    exit( 1 );
+  }
+  if( maxDeg > items ) maxDeg = items;
+  db = fopen( argv[5], "w" );
+  cf = fopen( argv[6], "w" );
+  pick = (int *)malloc( (items + 1) * sizeof(int) );
+  if( db == NULL || cf == NULL || pick == NULL ){
+    fprintf( stderr, "ERROR[%s]: Can't open %s or %s\n", argv[0], argv[5], argv[6] );
+    exit( 1 );
+  }
+  for( i=1; i <= items; i++ )
+    pick[i] = i;
+
+  fprintf( db, "%d\n", users );
+  for( u=1; u <= users; u++ ){
+    k = randInt( 1, maxDeg );
+    fprintf( db, "%d\t%d\t", u, k );
+    for( j=1; j <= k; j++ ){	// partial Fisher-Yates: k distinct friends
+      i = randInt( j, items );
+      t = pick[j];
+      pick[j] = pick[i];
+      pick[i] = t;
+      fprintf( db, j < k ? "%d %d " : "%d %d\n", pick[j], randInt( 1, 50 ) );
+    }
+  }
+  fprintf( cf, "%d\n", items );
+  for( i=1; i <= items; i++ )
+    fprintf( cf, "%d 0.%02d\n", i, randInt( 1, 99 ) );
+
+  free( pick );
+  if( fclose( db ) != 0 || fclose( cf ) != 0 ){
+    fprintf( stderr, "ERROR[%s]: Write failed\n", argv[0] );
+    exit( 1 );
+  }
+  return 0;
+}
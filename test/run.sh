@@ -0,0 +1,93 @@
+#!/bin/sh
+#
+# Regression suite. Builds SF-Tree and the generator with the test
+# limits, mines the header-comment example, a small maximal case and
+# two generated datasets (medium, large) and checks every run against
+#
+#   test/golden/<case>.txt    the groups found (-g); any missing or
+#                             extra group fails
+#   test/baseline/<case>.txt  phase times and peak RSS (-b), when the
+#                             file exists; a phase slower or larger
+#                             than the tolerance (-r) fails
+#
+# Baselines depend on the machine, so they are not kept in the tree:
+# record them once with -B on a trusted build, then gate optimized
+# builds against them.
+#
+#   test/run.sh [-r tolerance] [-B] [-u] [-- extra SF-Tree options]
+#     -r tolerance  percent a phase may exceed its baseline (default 25)
+#     -B            record the baselines of this run instead of checking
+#     -u            rewrite the goldens (only after checking the change)
+#
+# maximal.db is checked by hand at minSig 0.2 (52 of 260): {1} and
+# {2} reach 60 each and {1 2} has climp 80 but dgimp 20, so all four
+# single items are maximal; {1 3} and {2 4} fail climp (40).
+#
+# CC and CFLAGS pick the compiler and flags of the build under test.
+# The exit status is 1 when any case fails.
+
+dir=$(cd "$(dirname "$0")" && pwd)
+tolerance=25
+record=0
+update=0
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -r) tolerance="$2"; shift 2 ;;
+    -B) record=1; shift ;;
+    -u) update=1; shift ;;
+    --) shift; break ;;
+    *) echo "Usage: $0 [-r tolerance] [-B] [-u] [-- extra SF-Tree options]" >&2; exit 2 ;;
+  esac
+done
+
+extra="$*"
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/sftree-test-XXXXXX") || exit 2
+trap 'rm -rf "$work"' EXIT
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O3}
+LIMITS="-DMAXITEMS=256 -DMAXTRANSACTIONS=50000 -DMAXITEMSETS=2000000"
+$CC -Wall $CFLAGS $LIMITS "$dir/../SF-Tree.c" -o "$work/prog" -lm -lpthread || exit 2
+$CC -Wall -O2 "$dir/gen.c" -o "$work/gen" || exit 2
+
+# name, database, confidence table, minSig, options
+cases() {
+  echo "example $dir/example.db $dir/example.cf 0.05"
+  echo "medium $work/medium.db $work/medium.cf 0.005"
+  echo "maximal $dir/maximal.db $dir/maximal.cf 0.2 -M maximal"
+  echo "medium-closed $work/medium.db $work/medium.cf 0.005 -M closed"
+  echo "medium-maximal $work/medium.db $work/medium.cf 0.005 -M maximal"
+  echo "large $work/large.db $work/large.cf 0.005"
+}
+"$work/gen" 2000 30 10 1 "$work/medium.db" "$work/medium.cf" || exit 2
+"$work/gen" 20000 60 16 2 "$work/large.db" "$work/large.cf" || exit 2
+
+[ $record = 1 ] && mkdir -p "$dir/baseline"
+failed=0
+cases | while read -r name db cf minSig opts; do
+  golden="$dir/golden/$name.txt"
+  baseline="$dir/baseline/$name.txt"
+  set -- -q $opts $extra
+  if [ $update = 1 ]; then
+    "$work/prog" "$db" "$cf" "$work/out.txt" "$minSig" "$@" > /dev/null
+    grep -a -e 'Found ShFrequent Itemsets:' -e '^{' "$work/out.txt" > "$golden"
+    echo "$name: golden rewritten ($(grep -c '^{' "$golden") groups)"
+    continue
+  fi
+  set -- "$@" -g "$golden"
+  if [ $record = 1 ]; then
+    set -- "$@" -B "$baseline"
+  elif [ -f "$baseline" ]; then
+    set -- "$@" -b "$baseline" -r "$tolerance"
+  fi
+  if "$work/prog" "$db" "$cf" "$work/out.txt" "$minSig" "$@" > "$work/log.txt" 2>&1; then
+    echo "$name: ok"
+  else
+    echo "$name: FAIL"
+    grep -a -e 'golden' -e 'baseline' -e 'ERROR' "$work/log.txt"
+    echo fail >> "$work/failed"
+  fi
+done
+[ -f "$work/failed" ] && failed=1
+exit $failed